@@ -0,0 +1,26 @@
+#ifndef _COMMANDS_H_
+#define _COMMANDS_H_
+
+
+/*
+** Subcommands of csv_maker, argv[0] is name of subcommand
+*/
+int
+export_command(
+    int argc
+    , char ** argv);
+
+
+int
+linktest_command(
+    int argc
+    , char ** argv);
+
+
+int
+partner_sim_command(
+    int argc
+    , char ** argv);
+
+
+#endif
@@ -0,0 +1,276 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "csvmaker.h"
+#include "settings.h"
+#include "commands.h"
+
+
+/*
+** Printing of export usage
+*/
+static void
+export_usage(void)
+{
+    fprintf(
+        stderr
+        , "Usage: csv_maker export [options] [csv_path]\n"
+          "  -C config      take csv path, name and separator of cell from\n"
+          "                 configuration file\n"
+          "  -n cell        cell of configuration file (needed for more cells)\n"
+          "  -N name        prefix of csv file names\n"
+          "  -s separator   column separator\n"
+          "  -f from        first day or time (YYYY-MM-DD[ HH:MM:SS])\n"
+          "  -t to          last day or time (YYYY-MM-DD[ HH:MM:SS])\n"
+          "  -m model       only glasses of vehicle model (e.g. T7)\n"
+          "  -b batch       only glasses with KomponenteA_BatchId\n"
+          "  -w col=value   only rows with given column value\n"
+          "  -c col,col     output only given columns\n"
+          "  -j threads     number of parsing threads\n");
+}
+
+
+/*
+** Parsing of day with optional time. Time of day is normalized into format
+** used in csv file, it is empty when argument contains only date.
+*/
+static bool
+parse_time(
+    const char * argument
+    , time_t * day
+    , char * timestamp
+    , size_t size)
+{
+    int year, month, mday, hour = 0, minute = 0, second = 0;
+    int fields =
+        sscanf(
+            argument
+            , "%d-%d-%d %d:%d:%d"
+            , &year
+            , &month
+            , &mday
+            , &hour
+            , &minute
+            , &second);
+
+    if(fields != 3 && fields != 6)
+        return false;
+
+    struct tm tm =
+        {.tm_year = year - 1900
+        , .tm_mon = month - 1
+        , .tm_mday = mday
+        , .tm_hour = 12
+        , .tm_isdst = -1};
+
+    *day = mktime(&tm);
+
+    if(*day == (time_t) -1)
+        return false;
+
+    if(fields == 6)
+        snprintf(
+            timestamp
+            , size
+            , "%d-%02d-%02d %02d:%02d:%02d"
+            , year
+            , month
+            , mday
+            , hour
+            , minute
+            , second);
+    else
+        timestamp[0] = '\0';
+
+    return true;
+}
+
+
+/*
+** Csv context of cell from configuration file, cell name can be NULL
+** when file has only one cell
+*/
+static bool
+export_cell(
+    const char * path
+    , const char * name
+    , CellConfig * cell)
+{
+    static Config config;
+    CellConfig defaults = CELL_CONFIG_DEFAULTS;
+    char error[256];
+
+    if(config_load(&config, path, &defaults, error, sizeof(error)) == false)
+    {
+        fprintf(stderr, "Error in configuration %s: %s!\n", path, error);
+        return false;
+    }
+
+    const CellConfig * found =
+        name != NULL
+            ? config_find(&config, name)
+            : config.cell_count == 1 ? &config.cells[0] : NULL;
+
+    if(found == NULL)
+    {
+        fprintf(
+            stderr
+            , name != NULL
+                ? "Cell is not in configuration!\n"
+                : "Configuration has more cells, choose one by -n!\n");
+        return false;
+    }
+
+    *cell = *found;
+
+    return true;
+}
+
+
+int
+export_command(
+    int argc
+    , char ** argv)
+{
+    CellConfig cell = CELL_CONFIG_DEFAULTS;
+    ExportQuery query;
+    const char * config_path = NULL;
+    const char * cell_name = NULL;
+    const char * name = NULL;
+    const char * separator = NULL;
+    bool last_given = false;
+    int option;
+
+    export_query_init(&query, &(CsvMaker) {0});
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    query.threads = cpus > 0 ? (unsigned) cpus : 1;
+
+    while((option = getopt(argc, argv, "C:n:N:s:f:t:m:b:w:c:j:h")) != -1)
+    {
+        bool valid = true;
+
+        switch(option)
+        {
+            case 'C':
+                config_path = optarg;
+                break;
+
+            case 'n':
+                cell_name = optarg;
+                break;
+
+            case 'N':
+                name = optarg;
+                valid = strlen(name) < sizeof(cell.csv_name);
+                break;
+
+            case 's':
+                separator = optarg;
+                valid = strlen(separator) == 1;
+                break;
+
+            case 'f':
+                valid =
+                    parse_time(
+                        optarg
+                        , &query.first_day
+                        , query.from
+                        , sizeof(query.from));
+                break;
+
+            case 't':
+                valid =
+                    parse_time(
+                        optarg
+                        , &query.last_day
+                        , query.to
+                        , sizeof(query.to));
+                last_given = true;
+                break;
+
+            case 'm':
+                valid = export_add_filter(&query, "FahrzeugModell", optarg);
+                break;
+
+            case 'b':
+                valid = export_add_filter(&query, "KomponenteA_BatchId", optarg);
+                break;
+
+            case 'w':
+            {
+                char * value = strchr(optarg, '=');
+
+                if(value == NULL)
+                    valid = false;
+                else
+                {
+                    *value = '\0';
+                    valid = export_add_filter(&query, optarg, value + 1);
+                }
+                break;
+            }
+
+            case 'c':
+                valid = export_set_columns(&query, optarg);
+                break;
+
+            case 'j':
+                query.threads = (unsigned) atoi(optarg);
+                valid = query.threads > 0;
+                break;
+
+            default:
+                valid = false;
+                break;
+        }
+
+        if(valid == false)
+        {
+            export_usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if(last_given == false)
+        query.last_day = query.first_day;
+
+    if(config_path != NULL
+        && export_cell(config_path, cell_name, &cell) == false)
+        return EXIT_FAILURE;
+
+    if(name != NULL)
+        snprintf(cell.csv_name, sizeof(cell.csv_name), "%s", name);
+
+    if(separator != NULL)
+        cell.separator = separator[0];
+
+    if(optind < argc)
+        snprintf(cell.path, sizeof(cell.path), "%s", argv[optind]);
+
+    csv_maker_init(&query.csv_maker, cell.path, cell.csv_name, cell.separator);
+
+    ExportStats stats;
+    bool result = export_run(&query, stdout, &stats);
+
+    fprintf(
+        stderr
+        , "%u files, %llu bytes, %llu rows, %llu matched.\n"
+        , stats.files
+        , (unsigned long long) stats.bytes
+        , (unsigned long long) stats.rows
+        , (unsigned long long) stats.matched);
+
+    if(result == false)
+    {
+        fprintf(stderr, "Error during export!\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
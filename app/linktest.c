@@ -0,0 +1,497 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <snap7.h>
+
+#include "csvmaker.h"
+#include "settings.h"
+#include "commands.h"
+
+
+/*
+** Size of data blocks of local server stand-in
+*/
+#define LINKTEST_SERVER_DB_SIZE 8192
+
+/*
+** Largest transfer of size sweep
+*/
+#define LINKTEST_MAX_SIZE 4096
+
+
+/*
+** Percentiles of one measured operation
+*/
+typedef struct
+{
+    size_t count;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t max;
+    uint64_t mean;
+    int exec_ms;
+}LinkResult;
+
+
+/*
+** Settings of link test
+*/
+typedef struct
+{
+    const char * address;
+    size_t samples;
+    int scratch_db;
+    int max_size;
+    S7Object plc;
+    uint64_t * wall;
+    int * exec;
+}LinkTest;
+
+
+/*
+** Printing of linktest usage
+*/
+static void
+linktest_usage(void)
+{
+    fprintf(
+        stderr
+        , "Usage: csv_maker linktest [options]\n"
+          "  -a address     PLC address (default " IP_ADDRESS ")\n"
+          "  -n samples     number of measurements per size\n"
+          "  -m max_size    largest transfer of size sweep\n"
+          "  -w db          scratch data block for write measurements and"
+          " reads beyond\n"
+          "                 glass record, these are done only when given\n"
+          "  -L             run against local snap7 server stand-in\n");
+}
+
+
+static int
+compare_u64(
+    const void * a
+    , const void * b)
+{
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+
+    return (x > y) - (x < y);
+}
+
+
+static int
+compare_int(
+    const void * a
+    , const void * b)
+{
+    int x = *(const int *) a;
+    int y = *(const int *) b;
+
+    return (x > y) - (x < y);
+}
+
+
+/*
+** Computation of percentiles from measured samples
+*/
+static void
+link_result(
+    LinkTest * test
+    , size_t count
+    , LinkResult * result)
+{
+    qsort(test->wall, count, sizeof(test->wall[0]), compare_u64);
+    qsort(test->exec, count, sizeof(test->exec[0]), compare_int);
+
+    uint64_t sum = 0;
+
+    for(size_t i = 0; i < count; i++)
+        sum += test->wall[i];
+
+    *result = (LinkResult)
+        {.count = count
+        , .p50 = test->wall[count / 2]
+        , .p90 = test->wall[count * 90 / 100]
+        , .p99 = test->wall[count * 99 / 100]
+        , .max = test->wall[count - 1]
+        , .mean = sum / count
+        , .exec_ms = test->exec[count / 2]};
+}
+
+
+static void
+print_error(
+    const char * operation
+    , int size
+    , int error)
+{
+    char text[256];
+
+    Cli_ErrorText(error, text, sizeof(text));
+    fprintf(stderr, "%s of %d bytes failed: %s\n", operation, size, text);
+}
+
+
+static void
+print_header(void)
+{
+    fprintf(
+        stdout
+        , "%-8s %6s %6s %9s %9s %9s %9s %8s %10s\n"
+        , "op"
+        , "bytes"
+        , "n"
+        , "p50[us]"
+        , "p90[us]"
+        , "p99[us]"
+        , "max[us]"
+        , "exec[ms]"
+        , "kB/s");
+}
+
+
+static void
+print_result(
+    const char * operation
+    , int size
+    , const LinkResult * result)
+{
+    fprintf(
+        stdout
+        , "%-8s %6d %6zu %9llu %9llu %9llu %9llu %8d %10.1f\n"
+        , operation
+        , size
+        , result->count
+        , (unsigned long long) (result->p50 / 1000)
+        , (unsigned long long) (result->p90 / 1000)
+        , (unsigned long long) (result->p99 / 1000)
+        , (unsigned long long) (result->max / 1000)
+        , result->exec_ms
+        , result->mean > 0 ? size * 1e6 / result->mean : 0.0);
+}
+
+
+/*
+** Measuring of repeated read or write of size bytes from start of data
+** block
+*/
+static bool
+measure_transfer(
+    LinkTest * test
+    , bool write
+    , int db
+    , int size
+    , LinkResult * result)
+{
+    static char buffer[LINKTEST_MAX_SIZE];
+
+    for(size_t i = 0; i < test->samples; i++)
+    {
+        uint64_t start = rt_now_ns();
+        int error =
+            write == true
+                ? Cli_DBWrite(test->plc, db, 0, size, buffer)
+                : Cli_DBRead(test->plc, db, 0, size, buffer);
+
+        test->wall[i] = rt_now_ns() - start;
+
+        if(error != 0)
+        {
+            print_error(write == true ? "Write" : "Read", size, error);
+            return false;
+        }
+
+        Cli_GetExecTime(test->plc, &test->exec[i]);
+    }
+
+    link_result(test, test->samples, result);
+
+    return true;
+}
+
+
+/*
+** Measuring of one glass request as done by acquisition loop: request
+** bit is read, glass record is read, status is written, request bit is
+** read again and status is reset. Status is written only into scratch
+** data block.
+*/
+static bool
+measure_glass_pattern(
+    LinkTest * test
+    , LinkResult * result)
+{
+    char db[DB_GLASS_STRUCT_SIZE];
+    uint8_t status = 0;
+
+    for(size_t i = 0; i < test->samples; i++)
+    {
+        uint64_t start = rt_now_ns();
+        int error = Cli_DBRead(test->plc, DB_INDEX, 0, 1, &status);
+
+        if(error == 0)
+            error =
+                Cli_DBRead(test->plc, DB_INDEX, 0, DB_GLASS_STRUCT_SIZE, db);
+
+        if(error == 0 && test->scratch_db > 0)
+            error = Cli_DBWrite(test->plc, test->scratch_db, 0, 1, &status);
+
+        if(error == 0)
+            error = Cli_DBRead(test->plc, DB_INDEX, 0, 1, &status);
+
+        if(error == 0 && test->scratch_db > 0)
+            error = Cli_DBWrite(test->plc, test->scratch_db, 0, 1, &status);
+
+        test->wall[i] = rt_now_ns() - start;
+        test->exec[i] = 0;
+
+        if(error != 0)
+        {
+            print_error("Glass pattern", DB_GLASS_STRUCT_SIZE, error);
+            return false;
+        }
+    }
+
+    link_result(test, test->samples, result);
+
+    return true;
+}
+
+
+/*
+** Sweep of sizes 1, 2, 4, ... with record size inserted. Sizes beyond glass
+** record are transferred from large_db, because data block of glass is only
+** slightly larger than record on PLC. They are skipped when large_db is 0.
+*/
+static void
+sweep(
+    LinkTest * test
+    , const char * operation
+    , bool write
+    , int db
+    , int large_db)
+{
+    bool record_done = false;
+
+    for(int size = 1; size <= test->max_size; size *= 2)
+    {
+        LinkResult result;
+
+        if(size > DB_GLASS_STRUCT_SIZE && large_db == 0)
+        {
+            fprintf(
+                stdout
+                , "%-8s sizes above %d bytes skipped, give -w or -L\n"
+                , operation
+                , DB_GLASS_STRUCT_SIZE);
+            return;
+        }
+
+        if(size > DB_GLASS_STRUCT_SIZE)
+            db = large_db;
+
+        if(record_done == false && size >= DB_GLASS_STRUCT_SIZE)
+        {
+            record_done = true;
+
+            if(size != DB_GLASS_STRUCT_SIZE)
+            {
+                if(measure_transfer(
+                    test
+                    , write
+                    , db
+                    , DB_GLASS_STRUCT_SIZE
+                    , &result) == false)
+                    return;
+
+                print_result(operation, DB_GLASS_STRUCT_SIZE, &result);
+            }
+        }
+
+        if(measure_transfer(test, write, db, size, &result) == false)
+            return;
+
+        print_result(operation, size, &result);
+    }
+}
+
+
+int
+linktest_command(
+    int argc
+    , char ** argv)
+{
+    static uint8_t server_db[LINKTEST_SERVER_DB_SIZE];
+    static uint8_t server_scratch[LINKTEST_SERVER_DB_SIZE];
+    LinkTest test =
+        {.address = IP_ADDRESS
+        , .samples = 200
+        , .scratch_db = 0
+        , .max_size = LINKTEST_MAX_SIZE};
+    bool local = false;
+    int option;
+
+    while((option = getopt(argc, argv, "a:n:m:w:Lh")) != -1)
+    {
+        bool valid = true;
+
+        switch(option)
+        {
+            case 'a':
+                test.address = optarg;
+                break;
+
+            case 'n':
+                test.samples = (size_t) atol(optarg);
+                valid = atol(optarg) > 0;
+                break;
+
+            case 'm':
+                test.max_size = atoi(optarg);
+                valid = test.max_size > 0 && test.max_size <= LINKTEST_MAX_SIZE;
+                break;
+
+            case 'w':
+                test.scratch_db = atoi(optarg);
+                valid = test.scratch_db > 0 && test.scratch_db != DB_INDEX;
+                break;
+
+            case 'L':
+                local = true;
+                break;
+
+            default:
+                valid = false;
+                break;
+        }
+
+        if(valid == false)
+        {
+            linktest_usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    S7Object server = 0;
+
+    if(local == true)
+    {
+        server = Srv_Create();
+        Srv_RegisterArea(
+            server
+            , srvAreaDB
+            , DB_INDEX
+            , server_db
+            , sizeof(server_db));
+
+        if(test.scratch_db > 0)
+            Srv_RegisterArea(
+                server
+                , srvAreaDB
+                , (word) test.scratch_db
+                , server_scratch
+                , sizeof(server_scratch));
+
+        // ISO-on-TCP port 102 needs CAP_NET_BIND_SERVICE
+        if(Srv_StartTo(server, "127.0.0.1") != 0)
+        {
+            fprintf(stderr, "Error during starting local snap7 server!\n");
+            Srv_Destroy(&server);
+            return EXIT_FAILURE;
+        }
+
+        test.address = "127.0.0.1";
+    }
+
+    test.wall = malloc(test.samples * sizeof(test.wall[0]));
+    test.exec = malloc(test.samples * sizeof(test.exec[0]));
+    test.plc = Cli_Create();
+
+    int result = EXIT_FAILURE;
+    int error = Cli_ConnectTo(test.plc, test.address, RACK, SLOT);
+
+    if(test.wall == NULL || test.exec == NULL)
+        fprintf(stderr, "Error during allocation of samples!\n");
+    else if(error != 0)
+        print_error("Connection", 0, error);
+    else
+    {
+        int requested = 0;
+        int negotiated = 0;
+
+        Cli_GetPduLength(test.plc, &requested, &negotiated);
+
+        // read response carries 18 bytes of headers in every PDU
+        int payload = negotiated > 18 ? negotiated - 18 : 1;
+
+        fprintf(
+            stdout
+            , "Connected to %s (rack %d, slot %d).\n"
+              "PDU length: requested %d, negotiated %d, glass record needs"
+              " %d PDU(s).\n\n"
+            , test.address
+            , RACK
+            , SLOT
+            , requested
+            , negotiated
+            , (DB_GLASS_STRUCT_SIZE + payload - 1) / payload);
+
+        print_header();
+        sweep(
+            &test
+            , "read"
+            , false
+            , DB_INDEX
+            , local == true ? DB_INDEX : test.scratch_db);
+
+        if(test.scratch_db > 0)
+            sweep(&test, "write", true, test.scratch_db, test.scratch_db);
+
+        LinkResult record;
+        LinkResult pattern;
+
+        if(measure_transfer(
+                &test
+                , false
+                , DB_INDEX
+                , DB_GLASS_STRUCT_SIZE
+                , &record) == true
+            && measure_glass_pattern(&test, &pattern) == true)
+        {
+            fprintf(
+                stdout
+                , "\nPer glass round trips (%s):\n"
+                , test.scratch_db > 0
+                    ? "3 reads, 2 writes"
+                    : "3 reads, writes skipped without -w");
+            print_header();
+            print_result("pattern", DB_GLASS_STRUCT_SIZE, &pattern);
+            print_result("record", DB_GLASS_STRUCT_SIZE, &record);
+            fprintf(
+                stdout
+                , "Pattern p50 is %.1f times single record read.\n"
+                , record.p50 > 0 ? (double) pattern.p50 / record.p50 : 0.0);
+
+            result = EXIT_SUCCESS;
+        }
+
+        Cli_Disconnect(test.plc);
+    }
+
+    Cli_Destroy(&test.plc);
+    free(test.wall);
+    free(test.exec);
+
+    if(local == true)
+    {
+        Srv_Stop(server);
+        Srv_Destroy(&server);
+    }
+
+    return result;
+}
@@ -1,24 +1,34 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdint.h>
 #include <snap7.h>
 #include <errno.h>
 #include <stdbool.h>
 #include <unistd.h>
 #include <time.h>
+#include <pthread.h>
+#include <signal.h>
+
+#include "csvmaker.h"
+#include "settings.h"
+#include "commands.h"
+#include "sampler.h"
 
 
-/********************** configuration ************************/
-#define IP_ADDRESS "192.168.2.1"
-#define RACK 0
-#define SLOT 1
-#define DB_INDEX 18
-#define DB_PC_STATUS 288
-#define DB_GLASS_STRUCT_SIZE 288
+/*
+** Messages of acquisition loop. They are suppressed in real-time thread,
+** where no blocking I/O is allowed.
+*/
+static _Thread_local bool quiet = false;
+
+#define log_info(...) \
+    do { if(quiet == false) fprintf(stdout, __VA_ARGS__); } while(0)
 
-#define DEFAULT_CSV_PATH "./"
-#define CSV_NAME "Klebezelle"
-#define CSV_SEPARATOR ';'
+#define log_error(...) \
+    do { if(quiet == false) fprintf(stderr, __VA_ARGS__); } while(0)
 
 
 /********************* data types definitions *****************/
@@ -33,21 +43,12 @@ typedef enum
     , StatusWriteCsvLine
     , StateFinish
     , StateSuccess
+    , StateReject
     , StateFailure
     , StateDisconnect
 }State;
 
 
-/*
-** Enum with glass models
-*/
-typedef enum
-{
-   T7 = 7
-   , ID_BUZZ = 1
-}GlassModel;
-
-
 /*
 ** structure with state bits as part of PC/PLC communication interface
 */
@@ -55,925 +56,1606 @@ typedef struct
 {
     uint8_t success : 1;
     uint8_t failed : 1;
+    uint8_t rejected : 1;
 }PCInterface;
 
 
 /*
-** DTL structure for recording date and time
+** Configuration update handed over to running cell. Update which was
+** replaced before the output thread took it is chained as previous, so
+** it is freed by the output thread and never by real-time thread.
 */
-typedef struct
+typedef struct CellUpdate CellUpdate;
+
+struct CellUpdate
 {
-    uint16_t YEAR;
-    uint8_t MONTH;
-    uint8_t DAY;
-    uint8_t WEEKDAY;
-    uint8_t HOUR;
-    uint8_t MINUTE;
-    uint8_t SECOND;
-    uint32_t NANOSECOND;
-}DTL;
+    CellConfig config;
+    RuleSet rules;
+    bool rules_enabled;
+    Sampler * sampler;
+    CellUpdate * previous;
+};
 
 
 /*
-** Structure for holding results states from primer control of the glass
+** Structure with connection and outputs of one production cell. Cell has
+** its own thread, config is used by acquisition loop and outputs is
+** configuration of opened outputs, which belongs to the thread storing
+** glasses (output thread in real-time mode). Name never changes, it is
+** read by main thread.
 */
 typedef struct
 {
-    uint8_t zone1:1;
-    uint8_t zone2:1;
-    uint8_t zone3:1;
-    uint8_t zone4:1;
-}PrimerDetectionZones;
+    char name[CONFIG_NAME_SIZE];
+    CellConfig config;
+    CellConfig outputs;
+    bool outputs_applied;
+    _Atomic(CellUpdate *) pending;
+    _Atomic(CellUpdate *) pending_output;
+    atomic_bool stop;
+    atomic_bool output_stop;
+    pthread_t thread;
+    pthread_t output;
+    CsvMaker csv_maker;
+    Writer csv;
+    bool csv_open;
+    char csv_path[CSV_PATH_SIZE];
+    uint32_t csv_ids[CSV_APPEND_HISTORY];
+    RecoveryInfo last_glass;
+    bool recovered;
+    bool ack_lost;
+    RingWriter ring;
+    bool ring_enabled;
+    Spool spool;
+    bool spool_enabled;
+    Aggregator hourly;
+    Aggregator shift;
+    bool summary_enabled;
+    bool realtime;
+    RtOptions rt_options;
+    RtQueue queue;
+    LatencyHistogram wakeup;
+    LatencyHistogram ack;
+    _Atomic uint64_t overflows;
+    Sampler * sampler;
+    RuleSet rules;
+    bool rules_enabled;
+    char partner_buffer[PARTNER_BUFFER_SIZE];
+}Cell;
 
 
+/********************* csv_maker functions ***************/
+
 /*
-** Enum with Metralight inspection results state
+** State function for connection to the PLC.
+** This function cyclic trying to connect to PLC until it successfully connect
 */
-typedef enum
+State
+connection(
+    S7Object plc
+    , const Cell * cell)
 {
-    MetralightOK = 0x10
-    , MetralightNOK = 0x20
-    , MetralightError = 255
-}MetralightStatus;
+    if(Cli_ConnectTo(
+        plc
+        , cell->config.address
+        , cell->config.rack, cell->config.slot) == 0)
+    {
+        log_info("Cell %s: PLC successfully connected.\n", cell->name);
+        return StateReadStatus;
+    }
+    else
+        return StateConnection;
+}
 
 
 /*
-** Structure with validation information of barrel
+** State function for reading request status bit from PLC
+** This function cyclic reads request bit until it is not true
+** If something wrong with connection it tries to reconnect
 */
-typedef struct
+State
+read_status(
+    S7Object plc
+    , const Cell * cell)
 {
-    char batchNumber[17];
-    char serialNumber[17];
-    uint16_t expiration_year;
-    uint8_t expiration_month;
-    uint8_t expiration : 1;
-}BarrelInfo;
+    uint8_t store;
+
+    if(Cli_DBRead(plc, cell->config.db, 0, 1, &store) == 0)
+    {
+        if(store == true)
+            return StatusWriteCsvLine;
+        else
+            return StateReadStatus;
+    }
+    else
+        return StateDisconnect;
+}
 
 
 /*
-** Structure with information from glass production
+** Function for opening of csv file for given time. Opened file is kept
+** until the name of the csv file changes with the date.
 */
-typedef struct
+bool
+open_csv_file(
+    Cell * cell
+    , time_t t)
 {
-    char jobNr[11];
-    char vehicleNumber[14];
-    char rearWindow[19];
-    uint8_t vehicleModel;
-    uint32_t id;
-    uint8_t primerAppEnable : 1;
-    uint8_t primerInspectionEnable : 1;
-    uint8_t primerInspectionResult : 1;
-    uint8_t  metralightEn : 1;
-    uint8_t glueApplicationResult : 1;
-    uint8_t glueInspectionBypass : 1;
-    uint8_t robotCompleteSuccess :1;
-    uint8_t dispenseCompleteSuccess   : 1;
-    uint8_t rotaryUniteCompleteSucces : 1;
-    uint8_t addhesiveProcessComplete  : 1;
-    PrimerDetectionZones zones;
-    uint16_t drawerIndex;
-    DTL primerApplicationTime;
-    DTL primerFlashoffTime;
-    DTL timeSinceLastDispense;
-    DTL glueStartApplicationTime;
-    DTL glueEndApplicationTime;
-    DTL assemblyTime;
-    MetralightStatus metralightZone[12];
-    BarrelInfo A;
-    BarrelInfo B;
-    float aAppliedGlueAmount;
-    int pistolTemperatureMin;
-    float pistolTempDuringApp;
-    int pistolTemperatureMax;
-    int aPotTemperatureMin;
-    float aPotTempDuringApp;
-    int aPotTemperatureMax;
-    float bAppliedGlueAmount;
-    float aApplicationRatio;
-    float bApplicationRatio;
-    int32_t mixerTubeLife;
-    float ambientHumidity;
-    float ambientTemperature;
-}Glass;
-
-
-/*
-** Constants for csv header
-*/
-char * csv_header[][2] =
-{
-    {"JobNummer", ""}
-    , {"AuftragsNr", ""}
-    , {"ScheibenType", ""}
-    , {"FahrzeugModell", ""}
-    , {"ScheibenNr", ""}
-    , {"TS_PrimerAuftrag", "Datum / Uhrzeit"}
-    , {"PrimerDetektiert", "true/false/NaN"}
-    , {"PrimerDetektiertZones", "true/false/NaN"}
-    , {"TS_PrimerAbgetrocknet", "Datum / Uhrzeit"}
-    , {"TI_PrimerAufgebrachtBisKleberaupe", "s"}
-    , {"Lagerfach", ""}
-    , {"TS_LetzteSpuelungMischer", "Datum / Uhrzeit"}
-    , {"TS_KleberaupeStart", "Datum / Uhrzeit"}
-    , {"TS_KleberaupeFertig", "Datum / Uhrzeit"}
-    , {"Kleberaubenerkennung", "true/false/NaN"}
-    , {"Metralight-Ergebnis umgangen", "true/false/NaN"}
-    , {"MetralightZone1", "true/false/NaN"}
-    , {"MetralightZone2", "true/false/NaN"}
-    , {"MetralightZone3", "true/false/NaN"}
-    , {"MetralightZone4", "true/false/NaN"}
-    , {"MetralightZone5", "true/false/NaN"}
-    , {"MetralightZone6", "true/false/NaN"}
-    , {"MetralightZone7", "true/false/NaN"}
-    , {"MetralightZone8", "true/false/NaN"}
-    , {"MetralightZone9", "true/false/NaN"}
-    , {"MetralightZone10", "true/false/NaN"}
-    , {"MetralightZone11", "true/false/NaN"}
-    , {"MetralightZone12", "true/false/NaN"}
-    , {"TI_KleberaupeFertigBisScheibeEndnommen", "s"}
-    , {"KomponenteA_Unabgelaufen", "true/false"}
-    , {"KomponenteA_BatchId", ""}
-    , {"KomponenteA_SerienNr", ""}
-    , {"KomponenteA_Menge", "ml"}
-    , {"AppizierdueseTempMin", "°C"}
-    , {"AppizierdueseTempAktuell", "°C"}
-    , {"AppizierdueseTempMax", "°C"}
-    , {"KomponenteA_TempMin", "°C"}
-    , {"KomponenteA_TempAktuell", "°C"}
-    , {"KomponenteA_TempMax", "°C"}
-    , {"KomponenteB_Unabgelaufen", "true/false"}
-    , {"KomponenteB_BatchId", ""}
-    , {"KomponenteB_SerienNr", ""}
-    , {"KomponenteB_Menge", "ml"}
-    , {"MischungsverhaeltnisKomponenten", ""}
-    , {"MischerrohrLebensdauerVerbleibend", "s"}
-    , {"RoboterZyklusOhneFehler", "true/false"}
-    , {"DosiereinheitOhneFehler", "true/false"}
-    , {"DrehtischOhneFehler", "true/false"}
-    , {"KleberaupenauftragOhneFehler", "true/false"}
-};
+    char file_path[CSV_PATH_SIZE];
+    generate_csv_name(
+        &cell->csv_maker
+        , t
+        , file_path
+        , sizeof(file_path));
 
+    if(cell->csv_open == true
+      && strcmp(file_path, cell->csv_path) == 0)
+      return true;
 
-/********************* csv_maker functions ***************/
+    if(cell->csv_open == true
+      && writer_close(&cell->csv) == false)
+      fprintf(stderr, "Error during closing csv file!\n");
+
+    RecoveryInfo recovery;
+
+    if(recover_csv_tail(&cell->csv_maker, file_path, &recovery) == false)
+      fprintf(stderr, "Error during recovery of csv file %s!\n", file_path);
+    else
+    {
+      if(recovery.truncated > 0)
+        fprintf(
+          stdout
+          , "Torn csv line of %lld bytes removed.\n"
+          , (long long) recovery.truncated);
+
+      if(recovery.has_record == true)
+      {
+        cell->last_glass = recovery;
+        cell->recovered = true;
+        fprintf(
+          stdout
+          , "Last stored glass %u from %s.\n"
+          , (unsigned) recovery.last_id
+          , recovery.last_timestamp);
+      }
+    }
+
+    cell->csv_open =
+      writer_open(
+        &cell->csv
+        , file_path
+        , cell->outputs.backend
+        , cell->outputs.sync_interval);
+
+    if(cell->csv_open == true)
+    {
+      strcpy(cell->csv_path, file_path);
+      fprintf(
+        stdout
+        , "Csv file %s opened (%s).\n"
+        , file_path
+        , writer_backend_name(cell->csv.backend));
+    }
 
-#define read_bit(array, byte, bit) \
-    array[byte] & (1 << bit) ? 1 : 0
+    return cell->csv_open;
+}
 
 
 /*
-** function for swaping bytes of 16-bits variable
+** Closing of csv file after failed write. Asynchronous write can fail
+** after its glass was acknowledged, such glass is reported. Current glass
+** is answered with failure and the next request reopens the file, so torn
+** tail is recovered and current glass is not stored twice when its write
+** succeeded.
 */
-uint16_t
-swap_endian_int16(uint16_t n)
+void
+close_failed_csv(Cell * cell)
 {
-    return ((n>>8) | (n<<8));
+  uint64_t failed = cell->csv.failed_append;
+
+  if(failed != cell->csv.appends)
+  {
+    if(cell->csv.appends - failed < CSV_APPEND_HISTORY)
+      fprintf(
+        stderr
+        , "Glass %u was acknowledged, but it is not stored in csv file!\n"
+        , (unsigned) cell->csv_ids[failed % CSV_APPEND_HISTORY]);
+    else
+      fprintf(stderr, "Acknowledged glass is not stored in csv file!\n");
+  }
+
+  fprintf(stderr, "Error during writing csv file!\n");
+
+  // result is not checked, the writer has already failed
+  writer_close(&cell->csv);
+  cell->csv_open = false;
 }
 
 
 /*
-** function for swaping bytes of 32-bits variables
+** Function for storing of glass into csv file and all enabled outputs.
+** The first glass after recovery of csv file and glass requested again
+** after lost acknowledgement (repeated) are compared with the last stored
+** glass, other glasses are always stored, their ids need not be unique.
+** Raw record of the glass is published into shared memory ring.
 */
-uint32_t
-swap_endian_int32(uint32_t n)
+bool
+store_glass(
+    Cell * cell
+    , const char db[DB_GLASS_STRUCT_SIZE]
+    , const Glass * glass
+    , time_t now
+    , bool repeated)
 {
-    return (((n) >> 24)
-     | (((n) & 0x00FF0000) >> 8)
-     | (((n) & 0x0000FF00) << 8)
-     | ((n) << 24));
+  if(open_csv_file(cell, now) == false)
+  {
+    fprintf(stderr, "Error during openg csv file!\n");
+    return false;
+  }
+
+  bool check = repeated == true || cell->recovered == true;
+
+  cell->recovered = false;
+
+  if(check == true && recovery_is_last(&cell->last_glass, glass) == true)
+  {
+    fprintf(stdout, "Glass %u already stored.\n", (unsigned) glass->id);
+    return true;
+  }
+
+  char line[CSV_HEADER_SIZE + CSV_LINE_SIZE];
+  size_t length = 0;
+
+  if(cell->csv.offset == 0)
+  {
+    fprintf(stdout, "Creating new csv file.\n");
+    length =
+      format_csv_header(
+        &cell->csv_maker
+        , line
+        , CSV_HEADER_SIZE);
+  }
+
+  size_t line_length =
+    format_csv_line(
+      &cell->csv_maker
+      , glass
+      , line + length
+      , sizeof(line) - length);
+
+  if(line_length == 0)
+  {
+    fprintf(stderr, "Error during writing csv file!\n");
+    return false;
+  }
+
+  cell->csv_ids[(cell->csv.appends + 1) % CSV_APPEND_HISTORY] = glass->id;
+
+  if(writer_append(&cell->csv, line, length + line_length) == false)
+  {
+    close_failed_csv(cell);
+    return false;
+  }
+
+  fprintf(stdout, "Csv line stored.\n");
+
+  if(cell->spool_enabled == true
+    && spool_append(
+      &cell->spool
+      , line + length
+      , line_length
+      , glass->id
+      , now) == false)
+    fprintf(stderr, "Error during writing spool segment!\n");
+
+  recovery_set_last(&cell->last_glass, glass);
+
+  if(cell->ring_enabled == true)
+    ring_publish(&cell->ring, db);
+
+  if(cell->summary_enabled == true
+    && (aggregator_add(&cell->hourly, glass, now) == false
+      || aggregator_add(&cell->shift, glass, now) == false))
+    fprintf(stderr, "Error during writing summary file!\n");
+
+  if(cell->sampler != NULL)
+    sampler_request(cell->sampler, &cell->csv_maker, glass, now);
+
+  return true;
 }
 
 
 /*
-** function for swaping bytes of 32-bits float variable
+** Function for validation and storing of glass record received from PLC.
+** Rules read only their fields from the raw record. In real-time mode the
+** raw record is only handed over to output thread, which decodes it, and
+** request is acknowledged when it is queued. Glass failing validation
+** rule with fail action is not stored and request is answered with
+** failure, glass failing reject rule is stored and answered with rejected
+** bit. Returns state with answer for PLC.
 */
-float
-swap_endian_float(float n)
+State
+process_glass(
+    Cell * cell
+    , const char db[DB_GLASS_STRUCT_SIZE])
 {
-    return (float) swap_endian_int32((uint32_t) n);
+    GlassView view = {db};
+    time_t now = time(NULL);
+    State stored = StateSuccess;
+    bool repeated = cell->ack_lost;
+
+    cell->ack_lost = false;
+
+    if(cell->rules_enabled == true)
+    {
+      RuleVerdict verdict;
+
+      if(rules_evaluate(&cell->rules, view, &verdict) != RulePass)
+        log_info(
+          "Glass %u: rule %s (%s).\n"
+          , (unsigned) glass_view_id(view)
+          , cell->rules.rules[verdict.rule].name
+          , rule_action_to_string(verdict.action));
+
+      if(verdict.action == RuleFail)
+        return StateFailure;
+
+      if(verdict.action == RuleReject)
+        stored = StateReject;
+    }
+
+    if(cell->realtime == true)
+    {
+      if(rt_queue_push(&cell->queue, db, now, repeated) == true)
+        return stored;
+
+      atomic_fetch_add_explicit(&cell->overflows, 1, memory_order_relaxed);
+
+      return StateFailure;
+    }
+
+    Glass glass;
+
+    read_glass_structure(DB_GLASS_STRUCT_SIZE, db, &glass);
+
+    if(store_glass(cell, db, &glass, now, repeated) == true)
+      return stored;
+
+    return StateFailure;
 }
 
 
 /*
-** generic macro for swaping bytes of 16-bits or 32-bits
-** variable
+** State function for reading Glass structure from PLC and writing
+** new csv line into csv file
 */
-#define swap_endian(n)                 \
-    _Generic(                          \
-        (n)                            \
-        , int16_t: swap_endian_int16   \
-        , uint16_t: swap_endian_int16  \
-        , int32_t: swap_endian_int32   \
-        , uint32_t: swap_endian_int32  \
-        , float: swap_endian_float)    \
-            (n)
+State
+write_csv_line(
+    S7Object plc
+    , Cell * cell)
+{
+  char db[DB_GLASS_STRUCT_SIZE];
+
+  if(Cli_DBRead(plc, cell->config.db, 0, DB_GLASS_STRUCT_SIZE, db) == 0)
+    return process_glass(cell, db);
+  else
+      log_error("Error during reading PLC datablock!\n");
+
+    return StateFailure;
+}
 
 
 /*
-** Conversion of constatn defining vehicle model into
-** string representation
+** Status byte of PC interface. Bits are set explicitly, so padding bits of
+** the bit field never reach the PLC.
 */
-char *
-vehicle_model_to_string(
-  GlassModel model)
+uint8_t
+pc_status(PCInterface pc_interface)
 {
-  switch(model)
-  {
-    case T7:
-      return "T7";
-    case ID_BUZZ:
-      return "ID.BUZZ";
-    default:
-      return "NaN";
-  }
+    return (uint8_t)
+        (pc_interface.success
+        | pc_interface.failed << 1
+        | pc_interface.rejected << 2);
 }
 
 
 /*
-** Conversion DTL structure (structured time format) into seconds
+** Function for writing of PC interface status byte into PLC
 */
-uint64_t
-dtl_to_seconds(DTL dtl)
+int
+write_pc_status(
+    S7Object plc
+    , const Cell * cell
+    , PCInterface pc_interface)
 {
-  return ((uint64_t)(((((dtl.YEAR > 0) ? dtl.YEAR-1970 : 0))*31556925.216)
-  + (dtl.MONTH*30.4368499*86400)
-  + (dtl.DAY*86400)
-  + (dtl.HOUR*3600)
-  + (dtl.MINUTE*60)
-  + dtl.SECOND));
+    uint8_t status = pc_status(pc_interface);
+
+    return Cli_DBWrite(
+        plc
+        , cell->config.db
+        , cell->config.status_offset
+        , 1
+        , &status);
 }
 
 
 /*
-** Function which returns current time in string representation
-** in given format.
-** Returned string is allocated in bss memory location and must not be
-** freed
+** State function for settings of success state bit in PLC. When the bit
+** is not written, PLC requests stored glass again.
 */
-char *
-time_string(const char * format)
+State
+success(
+    S7Object plc
+    , Cell * cell)
 {
-	static char time_string[24];
+    PCInterface pc_interface =
+        {.success = true
+        , .failed = false};
 
-	time_t my_time;
-	struct tm* time_info;
+    if(write_pc_status(plc, cell, pc_interface) == 0)
+        return StateFinish;
 
-	time(&my_time);
-	time_info = localtime(&my_time);
-	strftime(time_string, 23, format, time_info);
+    cell->ack_lost = true;
 
-	return time_string;
+    return StateDisconnect;
 }
 
 
 /*
-** This function check if the given path in file system is valid
+** State function for settings of success and rejected state bits in PLC
 */
-bool
-is_path_valid(char * path)
+State
+reject(
+    S7Object plc
+    , Cell * cell)
 {
-	if(access(path, F_OK) != 0)
-	{
-		if(errno == ENOENT
-      || errno == ENOTDIR)
-			return false;
-	}
+    PCInterface pc_interface =
+        {.success = true
+        , .failed = false
+        , .rejected = true};
+
+    if(write_pc_status(plc, cell, pc_interface) == 0)
+        return StateFinish;
 
-	return true;
+    cell->ack_lost = true;
+
+    return StateDisconnect;
 }
 
 
 /*
-** Function for generation of output csv file name with address for
-** storing based on given prefix and current time
-** Returned string is allocated in bss memory location and must not be
-** freed
+** State function for waiting for reset request bit in PLC
 */
-char *
-generate_csv_name(
-    time_t t
-    , char * csv_path
-    , char * csv_name)
+State
+finish(
+    S7Object plc
+    , const Cell * cell)
 {
-    static char f[513];
+    uint8_t store;
+
+    if(Cli_DBRead(plc, cell->config.db, 0, 1, &store) == 0)
+    {
+        if(store == false)
+        {
+            PCInterface pc_interface =
+                {.success = false
+                , .failed = false};
+
+            if(write_pc_status(plc, cell, pc_interface) == 0)
+            {
+                log_info("Request finished.\n");
+                return StateReadStatus;
+            }
+        }
+        else
+            return StateFinish;
+    }
+
+    return StateDisconnect;
+}
 
-  	struct tm tm = *localtime(&t);
 
-    snprintf(
-        f
-        , 512
-        , "%s/%s-%d-%02d-%02d.csv"
-        , csv_path
-        , csv_name
-        , tm.tm_year + 1900
-        , tm.tm_mon + 1
-        , tm.tm_mday);
-
-    return f;
-}
-
-
-/*
-** Function for reading DTL structure from given byte_array and
-** given memory address
+/*
+** State function for settings of failure state bit in PLC
 */
-DTL
-read_dtl(
-    size_t base
-    , char byte_array[])
+State
+failure(
+    S7Object plc
+    , const Cell * cell)
 {
-    return (DTL)
-        {.YEAR = swap_endian(*(uint16_t*) (byte_array+base))
-         , .MONTH = byte_array[base+2]
-         , . DAY = byte_array[base+3]
-         , .WEEKDAY = byte_array[base+4]
-         , .HOUR = byte_array[base+5]
-         , .MINUTE = byte_array[base+6]
-         , .SECOND = byte_array[base+7]
-         , .NANOSECOND = swap_endian(*(uint32_t*) (byte_array+8))};
+    PCInterface pc_interface =
+        {.success = false
+        , .failed = true};
+
+    if(write_pc_status(plc, cell, pc_interface) == 0)
+        return StateFinish;
+    else
+        return StateDisconnect;
 }
 
 
 /*
-** Function for reading BarrelInfo structure from given byte_array and
-** given memory address
+** State function for disconnection of PLC connection
 */
-BarrelInfo
-read_barrel_info(
-    size_t base
-    , char byte_array[])
+State
+disconnect(S7Object plc)
 {
-    BarrelInfo barrel;
-
-    memcpy(barrel.batchNumber, byte_array+base+2, 17);
-    memcpy(barrel.serialNumber, byte_array+base+20, 17);
-    barrel.expiration_year = swap_endian(*(uint16_t*) (byte_array+base+36));
-    barrel.expiration_month = byte_array[base+38];
-    barrel.expiration = read_bit(byte_array, 39, 0);
+    Cli_Disconnect(plc);
 
-    return barrel;
+    return StateConnection;
 }
 
 
 /*
-** Function for parsing Glass structure from byte array. Returned Glass
-** structure is allocated in bss memory location and must not be freed
+** Periodic work of outputs: closing of summary buckets and sealing of
+** old spool segments
 */
-Glass *
-read_glass_structure(
-    size_t size
-    , char byte_array[size])
+void
+tick_outputs(
+    Cell * cell
+    , time_t now)
 {
-    static Glass glass;
+    if(cell->summary_enabled == true
+        && (aggregator_tick(&cell->hourly, now) == false
+            || aggregator_tick(&cell->shift, now) == false))
+        fprintf(stderr, "Error during writing summary file!\n");
+
+    if(cell->spool_enabled == true
+        && spool_tick(&cell->spool, now) == false)
+        fprintf(stderr, "Error during sealing spool segment!\n");
+}
 
-    memcpy(glass.jobNr, (byte_array+2), 10);
-    memcpy(glass.vehicleNumber, (byte_array+28), 13);
-    memcpy(glass.rearWindow, (byte_array+44), 18);
-    glass.vehicleModel = byte_array[62];
-    glass.id = swap_endian(*(uint32_t*)(byte_array+64));
-    glass.drawerIndex = swap_endian(*(uint16_t*)(byte_array+148));
-    memcpy(glass.metralightZone, (byte_array+196), 12);
-    glass.primerApplicationTime = read_dtl(74, byte_array);
-    glass.primerFlashoffTime = read_dtl(86, byte_array);
-    glass.timeSinceLastDispense = read_dtl(134, byte_array);
-    glass.glueStartApplicationTime = read_dtl(98, byte_array);
-    glass.glueEndApplicationTime = read_dtl(110, byte_array);
-    glass.assemblyTime = read_dtl(122, byte_array);
-    glass.A = read_barrel_info(208, byte_array);
-    glass.B = read_barrel_info(248, byte_array);
-    glass.aAppliedGlueAmount = swap_endian(*((float*) (byte_array+180)));
-    glass.bAppliedGlueAmount = swap_endian(*(float*) (byte_array+184));
-    glass.pistolTemperatureMin = swap_endian(*(int16_t*) (byte_array+152));
-    glass.pistolTempDuringApp = swap_endian(*(float*) (byte_array+172));
-    glass.pistolTemperatureMax = swap_endian(*(int16_t*) (byte_array+150));
-    glass.aPotTemperatureMin = swap_endian(*(int16_t*) (byte_array+156));
-    glass.aPotTempDuringApp = swap_endian(*(float*) (byte_array+176));
-    glass.aPotTemperatureMax = swap_endian(*(int16_t*) (byte_array+154));
-    glass.aApplicationRatio = swap_endian(*(float*) (byte_array+164));
-    glass.bApplicationRatio = swap_endian(*(float*) (byte_array+168));
-    glass.mixerTubeLife = swap_endian(*(int32_t*) (byte_array+158));
-    glass.ambientHumidity = swap_endian(*(float*) (byte_array+188));
-    glass.ambientTemperature = swap_endian(*(float*) (byte_array+192));
-    glass.primerAppEnable = read_bit(byte_array, 163, 3);
-    glass.primerInspectionEnable = read_bit(byte_array, 163, 2);
-    glass.primerInspectionResult = read_bit(byte_array, 162, 1);
-    glass.metralightEn = read_bit(byte_array, 162, 3);
-    glass.glueApplicationResult = read_bit(byte_array, 162, 2);
-    glass.glueInspectionBypass = read_bit(byte_array, 163, 4);
-    glass.robotCompleteSuccess = read_bit(byte_array, 162, 5);
-    glass.dispenseCompleteSuccess = read_bit(byte_array, 162, 4);
-    glass.rotaryUniteCompleteSucces = read_bit(byte_array, 162, 7);
-    glass.addhesiveProcessComplete = read_bit(byte_array, 163, 0);
-    glass.zones =
-        (PrimerDetectionZones)
-            {.zone1 = byte_array[146] && (1 << 0)
-            , .zone2 = byte_array[146] && (1 << 1)
-            , .zone3 = byte_array[146] && (1 << 2)
-            , .zone4 = byte_array[146] && (1 << 3)};
 
-    return &glass;
-}
-
-
-/*
-** Function for writing part of csv header into csv file
+/*
+** Function for opening, reopening and closing of outputs of cell, so they
+** match given configuration. Outputs whose settings did not change are
+** kept open. Curve sampler is given only to the first configured cell.
 */
 void
-print_csv_header(
-  FILE * csv
-  , int item_index)
+apply_outputs(
+    Cell * cell
+    , const CellConfig * config
+    , Sampler * sampler)
 {
-    for(size_t i = 0
-      ; i < (sizeof(csv_header) / sizeof(csv_header[0]))
-      ; i++)
+    const CellConfig * old = &cell->outputs;
+    bool first = cell->outputs_applied == false;
+    bool csv_changed =
+        first == true || cell_config_same_csv(old, config) == false;
+
+    if(csv_changed == true)
     {
-        if(i==0)
-            fprintf(csv, "%s", csv_header[i][item_index]);
-        else
-            fprintf(csv, ";%s", csv_header[i][item_index]);
+        if(cell->csv_open == true
+            && writer_close(&cell->csv) == false)
+            fprintf(stderr, "Error during closing csv file!\n");
+
+        cell->csv_open = false;
+        csv_maker_init(
+            &cell->csv_maker
+            , config->path
+            , config->csv_name
+            , config->separator);
+    }
+
+    if(csv_changed == true || old->summary != config->summary)
+    {
+        if(cell->summary_enabled == true
+            && (aggregator_flush(&cell->hourly, time(NULL)) == false
+                || aggregator_flush(&cell->shift, time(NULL)) == false))
+            fprintf(stderr, "Error during writing summary file!\n");
+
+        aggregator_init(
+            &cell->hourly
+            , &cell->csv_maker
+            , "Stunde"
+            , SUMMARY_HOUR_SECONDS
+            , 0
+            , time(NULL));
+        aggregator_init(
+            &cell->shift
+            , &cell->csv_maker
+            , "Schicht"
+            , SUMMARY_SHIFT_SECONDS
+            , SUMMARY_SHIFT_OFFSET
+            , time(NULL));
+        cell->summary_enabled = config->summary;
+    }
+
+    if(csv_changed == true || strcmp(old->outbox, config->outbox) != 0)
+    {
+        if(cell->spool_enabled == true
+            && spool_close(&cell->spool) == false)
+            fprintf(stderr, "Error during sealing spool segment!\n");
+
+        cell->spool_enabled =
+            config->outbox[0] != '\0'
+            && spool_open(
+                &cell->spool
+                , &cell->csv_maker
+                , config->outbox
+                , SPOOL_MAX_RECORDS
+                , SPOOL_MAX_SECONDS) == true;
+
+        if(config->outbox[0] != '\0' && cell->spool_enabled == false)
+            fprintf(stderr, "Error during opening spool directory!\n");
+    }
+
+    if(first == true || strcmp(old->ring, config->ring) != 0)
+    {
+        if(cell->ring_enabled == true)
+            ring_writer_close(&cell->ring, old->ring, true);
+
+        cell->ring_enabled =
+            config->ring[0] != '\0'
+            && ring_writer_open(&cell->ring, config->ring, RING_SLOTS) == true;
+
+        if(config->ring[0] != '\0' && cell->ring_enabled == false)
+            fprintf(stderr, "Error during opening shared memory ring!\n");
     }
+
+    cell->outputs = *config;
+    cell->outputs_applied = true;
+    cell->sampler = sampler;
 }
 
 
 /*
-** Function for writing whole csv header into csv file
+** Freeing of update with updates chained before it
 */
 void
-store_csv_header(FILE * csv)
+free_update(CellUpdate * update)
 {
-    print_csv_header(csv, 0);
-    fprintf(csv, "\n");
-    print_csv_header(csv, 1);
+    while(update != NULL)
+    {
+        CellUpdate * previous = update->previous;
+
+        free(update);
+        update = previous;
+    }
 }
 
 
 /*
-** This function prints DTL structure into given file
+** Function for closing of all outputs of cell
 */
-#define print_dtl(file, dtl)          \
-  fprintf(                            \
-    file                              \
-    , "%d-%02d-%02d %02d:%02d:%02d;"  \
-    , dtl.YEAR                        \
-    , dtl.MONTH                       \
-    , dtl.DAY                         \
-    , dtl.HOUR                        \
-    , dtl.MINUTE                      \
-    , dtl.SECOND)
+void
+close_outputs(Cell * cell)
+{
+    if(cell->csv_open == true
+        && writer_close(&cell->csv) == false)
+        fprintf(stderr, "Error during closing csv file!\n");
+
+    if(cell->summary_enabled == true
+        && (aggregator_flush(&cell->hourly, time(NULL)) == false
+            || aggregator_flush(&cell->shift, time(NULL)) == false))
+        fprintf(stderr, "Error during writing summary file!\n");
+
+    if(cell->spool_enabled == true
+        && spool_close(&cell->spool) == false)
+        fprintf(stderr, "Error during sealing spool segment!\n");
+
+    if(cell->ring_enabled == true)
+        ring_writer_close(&cell->ring, cell->outputs.ring, true);
+
+    cell->csv_open = false;
+    cell->summary_enabled = false;
+    cell->spool_enabled = false;
+    cell->ring_enabled = false;
+}
 
 
 /*
-** Function for writing new csv line into csv file from given Glass structure
+** Taking of configuration update by acquisition loop. It is called only
+** between requests, so no handshake is interrupted. Outputs are applied
+** by the thread which stores glasses, in real-time mode update is handed
+** over to output thread without freeing of memory. Returns true when PLC
+** connection settings changed.
 */
-void
-store_csv_line(
-  FILE * csv
-  , Glass * glass
-  , bool write_header)
-{
-    if(write_header == true)
-      store_csv_header(csv);
-
-    fprintf(csv, "\n%s;", glass->jobNr);
-    fprintf(csv, "%s;", glass->vehicleNumber);
-    fprintf(csv, "%s;", glass->rearWindow);
-    fprintf(csv, "%s;", vehicle_model_to_string(glass->vehicleModel));
-    fprintf(csv, "%d;", glass->id);
-
-    if(glass->primerAppEnable == true)
-      print_dtl(
-        csv
-        , glass->primerApplicationTime);
-    else
-      fprintf(csv, "NaN;");
-
-    if(glass->primerInspectionEnable == true)
-      fprintf(
-        csv
-        , "%s;"
-        , glass->primerInspectionResult ? "true" : "false");
-    else
-      fprintf(csv, "NaN;");
-
-    if(glass->primerInspectionEnable == true)
-      fprintf(
-        csv
-        , "%s-%s-%s-%s;"
-        , (glass->zones.zone1 ? "true" : "false")
-        , (glass->zones.zone2 ? "true" : "false")
-        , (glass->zones.zone3 ? "true" : "false")
-        , (glass->zones.zone4 ? "true" : "false"));
-    else
-      fprintf(csv, "NaN;");
+bool
+take_update(Cell * cell)
+{
+    CellUpdate * update = atomic_exchange(&cell->pending, NULL);
 
-    if(glass->primerAppEnable == true)
-      print_dtl(
-        csv
-        , glass->primerFlashoffTime);
-    else
-      fprintf(csv, "NaN;");
+    if(update == NULL)
+        return false;
 
-    // interval from primer application to start of glue application
-    if(glass->primerAppEnable == true)
-      fprintf(
-        csv
-        , "%lld;"
-        , dtl_to_seconds(glass->glueStartApplicationTime)
-          - dtl_to_seconds(glass->primerApplicationTime));
-    else
-      fprintf(csv, "NaN;");
+    bool reconnect =
+        cell_config_same_connection(&cell->config, &update->config) == false;
+    bool repin = cell->config.cpu != update->config.cpu;
 
-    fprintf(csv, "%d;", glass->drawerIndex);
-    print_dtl(csv, glass->timeSinceLastDispense);
-    print_dtl(csv, glass->glueStartApplicationTime);
-    print_dtl(csv, glass->glueEndApplicationTime);
+    cell->config = update->config;
+    cell->rules = update->rules;
+    cell->rules_enabled = update->rules_enabled;
 
-    if(glass->metralightEn == true)
-      fprintf(
-        csv
-        , "%s;"
-        , glass->glueApplicationResult ? "true" : "false");
-    else
-      fprintf(csv, "NaN;");
+    if(cell->realtime == true)
+    {
+        CellUpdate * previous = atomic_load(&cell->pending_output);
 
-    if(glass->metralightEn == true)
-      fprintf(
-        csv
-        , "%s;"
-        , glass->glueInspectionBypass ? "true" : "false");
-    else
-      fprintf(csv, "NaN;");
+        do
+            update->previous = previous;
+        while(atomic_compare_exchange_weak(
+            &cell->pending_output
+            , &previous
+            , update) == false);
 
-    if(glass->metralightEn == true)
-    {
-      for(int i = 0; i < 12; i++)
-      {
-        fprintf(
-          csv
-          , "%s;"
-          , glass->metralightZone[i] == MetralightOK ? "true" : "false");
-      }
+        if(repin == true)
+        {
+            cell->rt_options.cpu = cell->config.cpu;
+            rt_setup(&cell->rt_options, stderr);
+        }
     }
     else
     {
-      for(int i = 0; i < 12; i++)
-      {
-        fprintf(
-          csv
-          , "NaN;");
-      }
+        apply_outputs(cell, &update->config, update->sampler);
+        free_update(update);
     }
 
-    fprintf(
-      csv
-      , "%lld;"
-      , dtl_to_seconds(glass->assemblyTime)
-        - dtl_to_seconds(glass->glueEndApplicationTime));
+    return reconnect;
+}
 
-    fprintf(
-      csv
-      , "%s;"
-      , glass->A.expiration ? "true" : "false");
 
-    fprintf(
-      csv
-      , "%s;"
-      , glass->A.batchNumber);
+/*
+** Output thread of real-time mode. It stores glasses queued by
+** acquisition loop and periodically reports latency histograms.
+*/
+void *
+output_thread(void * argument)
+{
+    Cell * cell = argument;
+    time_t report = time(NULL);
+    const struct timespec idle = {.tv_nsec = RT_OUTPUT_IDLE_NS};
 
-    fprintf(
-      csv
-      , "%s;"
-      , glass->A.serialNumber);
+    while(atomic_load(&cell->output_stop) == false
+        || atomic_load(&cell->queue.head) != atomic_load(&cell->queue.tail))
+    {
+        RtRecord record;
+        bool stored = false;
+        CellUpdate * update = atomic_exchange(&cell->pending_output, NULL);
 
-    fprintf(
-      csv
-      , "%f;"
-      , glass->aAppliedGlueAmount);
+        if(update != NULL)
+        {
+            apply_outputs(cell, &update->config, update->sampler);
+            free_update(update);
+        }
 
-    fprintf(
-      csv
-      , "%d;"
-      , glass->pistolTemperatureMin);
+        while(rt_queue_pop(&cell->queue, &record) == true)
+        {
+            Glass glass;
+
+            read_glass_structure(DB_GLASS_STRUCT_SIZE, record.data, &glass);
+            store_glass(
+                cell
+                , record.data
+                , &glass
+                , record.time
+                , record.repeated);
+            stored = true;
+        }
 
-    fprintf(
-      csv
-      , "%f;"
-      , glass->pistolTempDuringApp);
+        time_t now = time(NULL);
 
-    fprintf(
-      csv
-      , "%d;"
-      , glass->pistolTemperatureMax);
+        tick_outputs(cell, now);
 
-    fprintf(
-      csv
-      , "%d;"
-      , glass->aPotTemperatureMin);
+        if(now - report >= RT_REPORT_SECONDS)
+        {
+            report = now;
+            fprintf(stdout, "Cell %s:\n", cell->name);
+            latency_histogram_print(&cell->wakeup, "Cycle wake up", stdout);
+            latency_histogram_print(&cell->ack, "Request to ack", stdout);
+
+            uint64_t overflows =
+                atomic_load_explicit(&cell->overflows, memory_order_relaxed);
+
+            if(overflows > 0)
+                fprintf(
+                    stdout
+                    , "Requests failed on full queue: %llu\n"
+                    , (unsigned long long) overflows);
+        }
 
-    fprintf(
-      csv
-      , "%f;"
-      , glass->aPotTempDuringApp);
+        fflush(stdout);
 
-    fprintf(
-      csv
-      , "%d;"
-      , glass->aPotTemperatureMax);
+        if(stored == false)
+            nanosleep(&idle, NULL);
+    }
 
-    fprintf(
-      csv
-      , "%s;"
-      , glass->B.expiration ? "true" : "false");
+    close_outputs(cell);
 
-    fprintf(
-      csv
-      , "%s;"
-      , glass->B.batchNumber);
+    return NULL;
+}
 
-    fprintf(
-      csv
-      , "%s;"
-      , glass->B.serialNumber);
 
-    fprintf(
-      csv
-      , "%f;"
-      , glass->bAppliedGlueAmount);
+/*
+** Switching of calling thread into real-time acquisition thread with
+** output thread for blocking work
+*/
+bool
+start_realtime(Cell * cell)
+{
+    // output thread is created before the scheduling is changed, so it
+    // does not inherit real-time priority and affinity
+    if(pthread_create(&cell->output, NULL, output_thread, cell) != 0)
+    {
+        fprintf(stderr, "Error during starting output thread!\n");
+        return false;
+    }
 
-    fprintf(
-      csv
-      , "%f:%f;"
-      , glass->aApplicationRatio
-      , glass->bApplicationRatio);
+    if(rt_setup(&cell->rt_options, stderr) == false)
+        fprintf(stderr, "Real-time mode is not complete!\n");
 
-    fprintf(
-      csv
-      , "%d;"
-      , glass->mixerTubeLife);
+    quiet = true;
 
-    fprintf(
-      csv
-      , "%s;"
-      , glass->robotCompleteSuccess ? "true" : "false");
+    return true;
+}
 
-    fprintf(
-      csv
-      , "%s;"
-      , glass->dispenseCompleteSuccess ? "true" : "false");
 
-    fprintf(
-      csv
-      , "%s;"
-      , glass->rotaryUniteCompleteSucces ? "true" : "false");
+/*
+** Sleeping for poll interval of cell
+*/
+void
+poll_sleep(const Cell * cell)
+{
+    const struct timespec interval =
+        {.tv_sec = cell->config.poll_us / 1000000
+        , .tv_nsec = (cell->config.poll_us % 1000000) * 1000};
 
-    fprintf(
-      csv
-      , "%s"
-      , glass->addhesiveProcessComplete ? "true" : "false");
+    nanosleep(&interval, NULL);
 }
 
 
 /*
-** State function for connection to the PLC.
-** This function cyclic trying to connect to PLC until it successfully connect
+** Period of real-time cycle, it is at least one microsecond
 */
-State
-connection(S7Object plc)
+long
+cycle_period_ns(const Cell * cell)
 {
-    if(Cli_ConnectTo(
-        plc
-        , IP_ADDRESS
-        , RACK, SLOT) == 0)
-    {
-        fprintf(stdout, "PLC successfully connected.\n");
-        return StateReadStatus;
-    }
-    else
-        return StateConnection;
+    return (cell->config.poll_us > 0 ? cell->config.poll_us : 1) * 1000L;
 }
 
 
 /*
-** State function for reading request status bit from PLC
-** This function cyclic reads request bit until it is not true
-** If something wrong with connection it tries to reconnect
+** Function where is main work cycle for communication with PLC. Work
+** cycle returns when cell is stopped or switched to partner transport.
 */
-State
-read_status(S7Object plc)
+void
+run(Cell * cell)
 {
-    uint8_t store;
+    S7Object plc = Cli_Create();
+    State state = StateConnection;
+    RtCycle cycle;
+    uint64_t request_ns = 0;
 
-    if(Cli_DBRead(plc, DB_INDEX, 0, 1, &store) == 0)
+    if(cell->realtime == true)
+        rt_cycle_init(&cycle, cycle_period_ns(cell));
+
+    while(true)
     {
-        if(store == true)
-            return StatusWriteCsvLine;
+        // configuration changes only between requests
+        if(state == StateConnection || state == StateReadStatus)
+        {
+            if(atomic_load(&cell->stop) == true)
+                break;
+
+            if(take_update(cell) == true && state == StateReadStatus)
+                state = StateDisconnect;
+
+            if(cell->config.partner[0] != '\0')
+                break;
+
+            if(cell->realtime == true)
+                cycle.period_ns = cycle_period_ns(cell);
+        }
+
+        State previous = state;
+
+        switch(state)
+        {
+            case StateConnection:
+                state = connection(plc, cell);
+                break;
+
+            case StateReadStatus:
+                state = read_status(plc, cell);
+                break;
+
+            case StatusWriteCsvLine:
+                state = write_csv_line(plc, cell);
+                break;
+
+            case StateFinish:
+                state = finish(plc, cell);
+                break;
+
+            case StateFailure:
+                state = failure(plc, cell);
+                break;
+
+            case StateSuccess:
+                state = success(plc, cell);
+                break;
+
+            case StateReject:
+                state = reject(plc, cell);
+                break;
+
+            case StateDisconnect:
+                state = disconnect(plc);
+                break;
+
+            default:
+                state = StateDisconnect;
+                break;
+        }
+
+        if(cell->realtime == true)
+        {
+            // request to ack time is measured from detection of request bit
+            // until the written status bit
+            if(previous == StateReadStatus && state == StatusWriteCsvLine)
+                request_ns = rt_now_ns();
+            else if((previous == StateSuccess
+                    || previous == StateReject
+                    || previous == StateFailure)
+                && state == StateFinish)
+                latency_histogram_add(&cell->ack, rt_now_ns() - request_ns);
+
+            rt_cycle_wait(&cycle, &cell->wakeup);
+        }
         else
-            return StateReadStatus;
+        {
+            tick_outputs(cell, time(NULL));
+            fflush(stdout);
+            poll_sleep(cell);
+        }
     }
-    else
-        return StateDisconnect;
+
+    Cli_Disconnect(plc);
+    Cli_Destroy(&plc);
 }
 
 
 /*
-** State function for reading Glass structure from PLC and writing
-** new csv line into csv file
+** Starting of partner for current configuration of cell
 */
-State
-write_csv_line(
-    S7Object plc
-    , char path[])
+S7Object
+start_partner(const Cell * cell)
 {
-  char db[DB_GLASS_STRUCT_SIZE];
+    S7Object partner = Par_Create(1);
 
-  if(Cli_DBRead(plc, DB_INDEX, 0, DB_GLASS_STRUCT_SIZE, db) == 0)
-  {
-    Glass * glass =
-      read_glass_structure(DB_GLASS_STRUCT_SIZE, db);
+    if(Par_StartTo(
+        partner
+        , PARTNER_LOCAL_ADDRESS
+        , cell->config.partner
+        , PARTNER_LOCAL_TSAP
+        , PARTNER_REMOTE_TSAP) != 0)
+        log_error("Error during starting PLC partner!\n");
 
-    char * file_path =
-      generate_csv_name(
-        time(NULL)
-        ,  path
-        , CSV_NAME);
+    return partner;
+}
 
-    bool write_csv_header =
-      access(file_path, F_OK) != 0;
 
-      FILE * csv =
-        fopen(
-            file_path
-          , "a");
+/*
+** Work cycle of partner transport. PLC pushes glass record by BSEND, it
+** is processed as in polling mode and answered by BSEND with status byte
+** and glass id, so no request bit is polled. Partner reconnects by itself
+** when connection is lost. Work cycle returns when cell is stopped or
+** switched back to polling.
+*/
+void
+run_partner(Cell * cell)
+{
+    // BRECV copies whole received block, buffer has the largest block size
+    char * buffer = cell->partner_buffer;
+    S7Object partner = start_partner(cell);
+    int linked = par_stopped;
 
-      if(csv != NULL)
-      {
-        if(write_csv_header == true)
-          fprintf(stdout, "Creating new csv file.\n");
+    while(atomic_load(&cell->stop) == false)
+    {
+        longword r_id = 0;
+        int size = 0;
+
+        if(Par_BRecv(
+            partner
+            , &r_id
+            , buffer
+            , &size
+            , PARTNER_RECV_TIMEOUT_MS) == 0)
+        {
+            uint64_t start = rt_now_ns();
+            GlassView view;
+            uint32_t id = 0;
+            State state = StateFailure;
 
-        store_csv_line(
-          csv
-          , glass
-          , write_csv_header);
+            if(r_id == PARTNER_GLASS_R_ID
+                && glass_view_init(&view, (size_t) size, buffer) == true)
+            {
+                id = glass_view_id(view);
+                state = process_glass(cell, buffer);
+            }
+            else
+                log_error("Unexpected partner block %u of %d bytes!\n"
+                    , (unsigned) r_id
+                    , size);
 
-        fclose(csv);
-        fprintf(stdout, "Csv line stored.\n");
+            PCInterface pc_interface =
+                {.success = state != StateFailure
+                , .failed = state == StateFailure
+                , .rejected = state == StateReject};
+            uint8_t ack[PARTNER_ACK_SIZE];
 
-        return StateSuccess;
-      }
-      else
-        fprintf(stderr, "Error during openg csv file!\n");
-  }
-  else
-      fprintf(stderr, "Error during reading PLC datablock!\n");
+            id = swap_endian_int32(id);
 
-    return StateFailure;
+            ack[0] = pc_status(pc_interface);
+            memcpy(ack + 1, &id, 4);
+
+            if(Par_BSend(partner, PARTNER_ACK_R_ID, ack, sizeof(ack)) != 0)
+            {
+                log_error("Error during sending partner acknowledgement!\n");
+                cell->ack_lost = state != StateFailure;
+            }
+            else if(cell->realtime == true)
+                latency_histogram_add(&cell->ack, rt_now_ns() - start);
+        }
+
+        int status = par_stopped;
+        Par_GetStatus(partner, &status);
+
+        if(status != linked)
+        {
+            if(status == par_linked)
+                log_info("Cell %s: PLC partner linked.\n", cell->name);
+            else if(linked == par_linked)
+                log_info(
+                    "Cell %s: PLC partner connection lost.\n"
+                    , cell->name);
+
+            linked = status;
+        }
+
+        if(take_update(cell) == true)
+        {
+            Par_Stop(partner);
+            Par_Destroy(&partner);
+
+            if(cell->config.partner[0] == '\0')
+                return;
+
+            partner = start_partner(cell);
+            linked = par_stopped;
+        }
+
+        if(cell->realtime == false)
+        {
+            tick_outputs(cell, time(NULL));
+            fflush(stdout);
+        }
+    }
+
+    Par_Stop(partner);
+    Par_Destroy(&partner);
 }
 
 
 /*
-** State function for settings of success state bit in PLC
+** Thread of one cell. It runs polling or partner work cycle until the
+** cell is stopped, then it closes outputs of the cell.
 */
-State
-success(S7Object plc)
+void *
+cell_thread(void * argument)
 {
-    PCInterface pc_interface =
-        {.success = true
-        , .failed = false};
+    Cell * cell = argument;
 
-    if(Cli_DBWrite(
-        plc
-        , DB_INDEX
-        , DB_PC_STATUS
-        , 1
-        , &pc_interface) == 0)
-        return StateFinish;
+    if(cell->realtime == true && start_realtime(cell) == false)
+    {
+        close_outputs(cell);
+        return NULL;
+    }
+
+    while(atomic_load(&cell->stop) == false)
+    {
+        if(cell->config.partner[0] != '\0')
+            run_partner(cell);
+        else
+            run(cell);
+    }
+
+    if(cell->realtime == true)
+    {
+        atomic_store(&cell->output_stop, true);
+        pthread_join(cell->output, NULL);
+    }
     else
-        return StateDisconnect;
+        close_outputs(cell);
+
+    free_update(atomic_exchange(&cell->pending, NULL));
+    free_update(atomic_exchange(&cell->pending_output, NULL));
+
+    return NULL;
 }
 
 
 /*
-** State function for waiting for reset request bit in PLC
+** Preparing of update for cell with validation of configuration and
+** compilation of its rule file
 */
-State
-finish(S7Object plc)
+CellUpdate *
+prepare_update(
+    const CellConfig * config
+    , char * error
+    , size_t error_size)
 {
-    uint8_t store;
+    CellUpdate * update = calloc(1, sizeof(CellUpdate));
 
-    if(Cli_DBRead(plc, DB_INDEX, 0, 1, &store) == 0)
+    if(update == NULL)
     {
-        if(store == false)
-        {
-            PCInterface pc_interface =
-                {.success = false
-                , .failed = false};
+        snprintf(error, error_size, "out of memory");
+        return NULL;
+    }
 
-            if(Cli_DBWrite(plc, DB_INDEX, DB_PC_STATUS, 1, &pc_interface) == 0)
-            {
-                fprintf(stdout, "Request finished.\n");
-                return StateReadStatus;
-            }
+    update->config = *config;
+
+    if(config->rules[0] != '\0')
+    {
+        char message[128];
+
+        if(rules_load(&update->rules, config->rules, message, sizeof(message))
+            == false)
+        {
+            snprintf(
+                error
+                , error_size
+                , "cell %s: rules %s"
+                , config->name
+                , message);
+            free(update);
+            return NULL;
         }
-        else
-            return StateFinish;
+
+        update->rules_enabled = true;
     }
 
-    return StateDisconnect;
+    return update;
 }
 
 
 /*
-** State function for settings of failure state bit in PLC
+** Creation of cell from validated update and starting of its thread.
+** Outputs are opened before the thread starts.
 */
-State
-failure(S7Object plc)
+Cell *
+start_cell(
+    CellUpdate * update
+    , bool realtime
+    , const RtOptions * rt_options)
 {
-    PCInterface pc_interface =
-        {.success = false
-        , .failed = true};
+    Cell * cell = calloc(1, sizeof(Cell));
+
+    if(cell == NULL)
+        return NULL;
+
+    memcpy(cell->name, update->config.name, sizeof(cell->name));
+    cell->config = update->config;
+    cell->rules = update->rules;
+    cell->rules_enabled = update->rules_enabled;
+    cell->realtime = realtime;
+    cell->rt_options = *rt_options;
+    cell->rt_options.cpu = update->config.cpu;
+    atomic_init(&cell->pending, NULL);
+    atomic_init(&cell->pending_output, NULL);
+    atomic_init(&cell->stop, false);
+    atomic_init(&cell->output_stop, false);
+    rt_queue_init(&cell->queue);
+    latency_histogram_init(&cell->wakeup);
+    latency_histogram_init(&cell->ack);
+    atomic_init(&cell->overflows, 0);
+    apply_outputs(cell, &cell->config, update->sampler);
+    free_update(update);
 
-    if(Cli_DBWrite(plc, DB_INDEX, DB_PC_STATUS, 1, &pc_interface) == 0)
-        return StateFinish;
-    else
-        return StateDisconnect;
+    fprintf(
+        stdout
+        , "Cell %s: connecting to plc %s...\n"
+        , cell->name
+        , cell->config.partner[0] != '\0'
+            ? cell->config.partner
+            : cell->config.address);
+    fflush(stdout);
+
+    if(pthread_create(&cell->thread, NULL, cell_thread, cell) != 0)
+    {
+        close_outputs(cell);
+        free(cell);
+        return NULL;
+    }
+
+    return cell;
 }
 
 
 /*
-** State function for disconnection of PLC connection
+** Stopping of cell thread at the next point between requests
 */
-State
-disconnect(S7Object plc)
+void
+stop_cell(Cell * cell)
 {
-    Cli_Disconnect(plc);
+    atomic_store(&cell->stop, true);
+    pthread_join(cell->thread, NULL);
+    fprintf(stdout, "Cell %s stopped.\n", cell->name);
+    free(cell);
+}
 
-    return StateConnection;
+
+/*
+** Printing of command line usage
+*/
+void
+usage(const char * program)
+{
+    fprintf(
+        stderr
+        , "Usage: %s [-c config] [-r ring_name] [-s] [-u] [-S outbox]"
+          " [-T priority [-C cpu]] [-i poll_us]\n"
+          "          [-A channel ... [-H rate_hz]] [-R rules] [-P address]"
+          " [csv_path]\n"
+          "       %s export [options] [csv_path]\n"
+          "       %s linktest [options]\n"
+          "       %s partner-sim [options]\n"
+          "  -c config     read cells from configuration file, SIGHUP"
+          " reloads it\n"
+          "  -r ring_name  publish decoded glasses into POSIX shared memory"
+          " ring (e.g. /csv_maker)\n"
+          "  -s            write hourly and per shift summary files\n"
+          "  -u            write csv file through io_uring when available\n"
+          "  -S outbox     publish sealed csv segments into outbox directory\n"
+          "  -T priority   run acquisition loop with SCHED_FIFO priority and"
+          " locked memory\n"
+          "  -C cpu        pin real-time acquisition loop to cpu\n"
+          "  -i poll_us    poll interval of request bit, cycle period in"
+          " real-time mode\n"
+          "  -A channel    sample process curve channel during glue"
+          " application (DB20.DBD0 REAL, DB20.DBW4 INT, DB20.DBB6 BYTE)\n"
+          "  -H rate_hz    sampling rate of process curves\n"
+          "  -R rules      validate glasses with rule file before"
+          " acknowledgement\n"
+          "  -P address    receive glasses pushed by PLC partner (BSEND)"
+          " instead of polling request bit\n"
+          "Options except -c, -T, -A and -H are defaults of cells in"
+          " configuration file.\n"
+        , program
+        , program
+        , program
+        , program);
+}
+
+
+/*
+** Loading of configuration of all cells. Without configuration file
+** there is one cell made from defaults.
+*/
+bool
+load_config(
+    Config * config
+    , const char * path
+    , const CellConfig * defaults
+    , char * error
+    , size_t error_size)
+{
+    if(path != NULL)
+        return config_load(config, path, defaults, error, error_size);
+
+    config->cell_count = 1;
+    config->cells[0] = *defaults;
+
+    return cell_config_validate(&config->cells[0], error, error_size);
+}
+
+
+/*
+** Preparing of updates of all cells, so new configuration is applied
+** only when it is valid as a whole
+*/
+bool
+prepare_updates(
+    const Config * config
+    , CellUpdate * updates[CONFIG_MAX_CELLS]
+    , char * error
+    , size_t error_size)
+{
+    for(size_t i = 0; i < config->cell_count; i++)
+    {
+        updates[i] = prepare_update(&config->cells[i], error, error_size);
+
+        if(updates[i] == NULL)
+        {
+            while(i > 0)
+                free(updates[--i]);
+
+            return false;
+        }
+    }
+
+    return true;
 }
 
 
 /*
-** Function where is main work cycle for communication with PLC
+** Giving of curve sampler to the first configured cell, sampler follows
+** PLC endpoint of the cell
 */
 void
-run(char * path)
+attach_sampler(
+    const Config * config
+    , CellUpdate * updates[CONFIG_MAX_CELLS]
+    , Sampler * sampler)
 {
-    S7Object plc = Cli_Create();
-    State state = StateConnection;
+    const CellConfig * first = &config->cells[0];
+
+    updates[0]->sampler = sampler;
+    sampler_set_plc(
+        sampler
+        , first->partner[0] != '\0' ? first->partner : first->address
+        , first->rack
+        , first->slot);
+}
 
-    while(true)
+
+/*
+** Applying of reloaded configuration. Removed cells are stopped, running
+** cells take their update at the next point between requests and new
+** cells are started.
+*/
+void
+reload_cells(
+    Cell * cells[CONFIG_MAX_CELLS]
+    , size_t * cell_count
+    , const Config * config
+    , CellUpdate * updates[CONFIG_MAX_CELLS]
+    , bool realtime
+    , const RtOptions * rt_options)
+{
+    size_t kept = 0;
+
+    for(size_t i = 0; i < *cell_count; i++)
     {
-        switch(state)
+        if(config_find(config, cells[i]->name) == NULL)
+            stop_cell(cells[i]);
+        else
+            cells[kept++] = cells[i];
+    }
+
+    *cell_count = kept;
+
+    for(size_t i = 0; i < config->cell_count; i++)
+    {
+        Cell * cell = NULL;
+
+        for(size_t j = 0; j < kept; j++)
+            if(strcmp(cells[j]->name, config->cells[i].name) == 0)
+                cell = cells[j];
+
+        if(cell != NULL)
+            free_update(atomic_exchange(&cell->pending, updates[i]));
+        else if((cell = start_cell(updates[i], realtime, rt_options)) != NULL)
+            cells[(*cell_count)++] = cell;
+        else
+            fprintf(
+                stderr
+                , "Error during starting cell %s!\n"
+                , config->cells[i].name);
+    }
+}
+
+
+int
+main(int argc, char ** argv)
+{
+    if(argc > 1 && strcmp(argv[1], "export") == 0)
+        return export_command(argc - 1, argv + 1);
+
+    if(argc > 1 && strcmp(argv[1], "linktest") == 0)
+        return linktest_command(argc - 1, argv + 1);
+
+    if(argc > 1 && strcmp(argv[1], "partner-sim") == 0)
+        return partner_sim_command(argc - 1, argv + 1);
+
+    static Sampler sampler;
+    static Config config;
+    CellConfig defaults = CELL_CONFIG_DEFAULTS;
+    const char * config_path = NULL;
+    bool sampler_enabled = false;
+    bool realtime = false;
+    RtOptions rt_options =
+        {.priority = RT_PRIORITY
+        , .cpu = -1};
+    unsigned rate_hz = SAMPLER_RATE_HZ;
+    int option;
+
+    while((option = getopt(argc, argv, "c:r:suS:T:C:i:A:H:R:P:h")) != -1)
+    {
+        switch(option)
         {
-            case StateConnection:
-                state = connection(plc);
+            case 'c':
+                config_path = optarg;
                 break;
 
-            case StateReadStatus:
-                state = read_status(plc);
+            case 'r':
+                snprintf(defaults.ring, sizeof(defaults.ring), "%s", optarg);
                 break;
 
-            case StatusWriteCsvLine:
-                state = write_csv_line(plc, path);
+            case 's':
+                defaults.summary = true;
                 break;
 
-            case StateFinish:
-                state = finish(plc);
+            case 'u':
+                defaults.backend = WriterUring;
                 break;
 
-            case StateFailure:
-                state = failure(plc);
+            case 'S':
+                snprintf(
+                    defaults.outbox
+                    , sizeof(defaults.outbox)
+                    , "%s"
+                    , optarg);
                 break;
 
-            case StateSuccess:
-                state = success(plc);
+            case 'T':
+                realtime = true;
+                rt_options.priority = atoi(optarg);
                 break;
 
-            case StateDisconnect:
-                state = disconnect(plc);
+            case 'C':
+                defaults.cpu = atoi(optarg);
                 break;
 
-            default:
-                state = StateDisconnect;
+            case 'i':
+                defaults.poll_us = atol(optarg);
+
+                if(defaults.poll_us <= 0)
+                {
+                    usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
                 break;
+
+            case 'A':
+                if(sampler_add_channel(&sampler, optarg) == false)
+                {
+                    fprintf(stderr, "Invalid curve channel %s!\n", optarg);
+                    return EXIT_FAILURE;
+                }
+
+                sampler_enabled = true;
+                break;
+
+            case 'H':
+                rate_hz = (unsigned) atoi(optarg);
+                break;
+
+            case 'P':
+                snprintf(
+                    defaults.partner
+                    , sizeof(defaults.partner)
+                    , "%s"
+                    , optarg);
+                break;
+
+            case 'R':
+                snprintf(defaults.rules, sizeof(defaults.rules), "%s", optarg);
+                break;
+
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
         }
+    }
 
-        fflush(stdout);
-        sleep(0.5);
+    if(optind < argc)
+        snprintf(defaults.path, sizeof(defaults.path), "%s", argv[optind]);
+
+    rt_options.period_ns = defaults.poll_us * 1000L;
+
+    char error[256];
+    CellUpdate * updates[CONFIG_MAX_CELLS];
+
+    if(load_config(&config, config_path, &defaults, error, sizeof(error))
+            == false
+        || prepare_updates(&config, updates, error, sizeof(error)) == false)
+    {
+        fprintf(stderr, "Invalid configuration: %s!\n", error);
+        return EXIT_FAILURE;
     }
 
-    Cli_Destroy(&plc);
-}
+    // signals are blocked in all threads and received only by sigwait below,
+    // SIGHUP reloads configuration, SIGINT and SIGTERM stop all cells
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGHUP);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
 
+    const CellConfig * first = &config.cells[0];
 
-int
-main(int argc, char ** argv)
-{
-    fprintf(stdout, "Connecting to plc...\n");
-    fflush(stdout);
+    // curve sampler belongs to the first cell
+    if(sampler_enabled == true)
+    {
+        if(sampler_start(
+            &sampler
+            , first->partner[0] != '\0' ? first->partner : first->address
+            , first->rack
+            , first->slot
+            , rate_hz) == false)
+        {
+            fprintf(stderr, "Error during starting curve sampler!\n");
+            return EXIT_FAILURE;
+        }
 
-    if(argc > 1)
-        run(argv[1]);
-    else
-        run(DEFAULT_CSV_PATH);
+        attach_sampler(&config, updates, &sampler);
+    }
+
+    Cell * cells[CONFIG_MAX_CELLS];
+    size_t cell_count = 0;
+
+    for(size_t i = 0; i < config.cell_count; i++)
+    {
+        if(updates[i]->rules_enabled == true)
+            fprintf(
+                stdout
+                , "Cell %s: %zu validation rules loaded.\n"
+                , config.cells[i].name
+                , updates[i]->rules.count);
+
+        Cell * cell = start_cell(updates[i], realtime, &rt_options);
+
+        if(cell == NULL)
+        {
+            fprintf(
+                stderr
+                , "Error during starting cell %s!\n"
+                , config.cells[i].name);
+            return EXIT_FAILURE;
+        }
+
+        cells[cell_count++] = cell;
+    }
+
+    while(true)
+    {
+        int signal_number = 0;
+
+        if(sigwait(&signals, &signal_number) != 0
+            || signal_number != SIGHUP)
+            break;
+
+        static Config reloaded;
+
+        if(load_config(&reloaded, config_path, &defaults, error, sizeof(error))
+                == false
+            || prepare_updates(&reloaded, updates, error, sizeof(error))
+                == false)
+        {
+            fprintf(stderr, "Configuration not reloaded: %s!\n", error);
+            continue;
+        }
+
+        if(sampler_enabled == true)
+            attach_sampler(&reloaded, updates, &sampler);
+
+        reload_cells(
+            cells
+            , &cell_count
+            , &reloaded
+            , updates
+            , realtime
+            , &rt_options);
+        config = reloaded;
+        fprintf(
+            stdout
+            , "Configuration reloaded, %zu cells running.\n"
+            , cell_count);
+        fflush(stdout);
+    }
+
+    for(size_t i = 0; i < cell_count; i++)
+        stop_cell(cells[i]);
 
     return EXIT_SUCCESS;
 }
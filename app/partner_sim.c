@@ -0,0 +1,234 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#include <snap7.h>
+
+#include "csvmaker.h"
+#include "settings.h"
+#include "commands.h"
+
+
+/*
+** Printing of partner-sim usage
+*/
+static void
+partner_sim_usage(void)
+{
+    fprintf(
+        stderr
+        , "Usage: csv_maker partner-sim [options]\n"
+          "  -l address     local address to listen on (default 127.0.0.1)\n"
+          "  -a address     address of csv_maker partner (default 127.0.0.1)\n"
+          "  -n count       number of glasses to send\n"
+          "  -i interval_ms pause between glasses\n"
+          "  -s id          id of the first glass\n");
+}
+
+
+static void
+store_u16(
+    char * p
+    , uint16_t value)
+{
+    value = swap_endian_int16(value);
+    memcpy(p, &value, 2);
+}
+
+
+static void
+store_u32(
+    char * p
+    , uint32_t value)
+{
+    value = swap_endian_int32(value);
+    memcpy(p, &value, 4);
+}
+
+
+/*
+** Writing of DTL in PLC layout
+*/
+static void
+store_dtl(
+    char * p
+    , time_t t)
+{
+    struct tm tm;
+    localtime_r(&t, &tm);
+
+    store_u16(p, (uint16_t) (tm.tm_year + 1900));
+    p[2] = (char) (tm.tm_mon + 1);
+    p[3] = (char) tm.tm_mday;
+    p[4] = (char) (tm.tm_wday + 1);
+    p[5] = (char) tm.tm_hour;
+    p[6] = (char) tm.tm_min;
+    p[7] = (char) tm.tm_sec;
+    store_u32(p + 8, 0);
+}
+
+
+/*
+** Synthetic glass record as sent by PLC program
+*/
+static void
+build_record(
+    char db[DB_GLASS_STRUCT_SIZE]
+    , uint32_t id
+    , time_t now)
+{
+    memset(db, 0, DB_GLASS_STRUCT_SIZE);
+    memcpy(db + GLASS_OFFSET_JOB_NR, "SIM0000001", GLASS_JOB_NR_SIZE);
+    db[GLASS_OFFSET_VEHICLE_MODEL] = T7;
+    store_u32(db + GLASS_OFFSET_ID, id);
+    store_dtl(db + GLASS_OFFSET_GLUE_START_TIME, now - 20);
+    store_dtl(db + GLASS_OFFSET_GLUE_END_TIME, now - 5);
+    store_dtl(db + GLASS_OFFSET_ASSEMBLY_TIME, now);
+}
+
+
+/*
+** Stand-in for PLC with partner transport. It is passive partner like the
+** PLC, pushes glass records to csv_maker started with -P and measures time
+** until acknowledgement arrives.
+*/
+int
+partner_sim_command(
+    int argc
+    , char ** argv)
+{
+    static char ack[PARTNER_BUFFER_SIZE];
+    const char * local = "127.0.0.1";
+    const char * remote = "127.0.0.1";
+    long count = 100;
+    long interval_ms = 1000;
+    uint32_t id = 1;
+    int option;
+
+    while((option = getopt(argc, argv, "l:a:n:i:s:h")) != -1)
+    {
+        switch(option)
+        {
+            case 'l':
+                local = optarg;
+                break;
+
+            case 'a':
+                remote = optarg;
+                break;
+
+            case 'n':
+                count = atol(optarg);
+                break;
+
+            case 'i':
+                interval_ms = atol(optarg);
+                break;
+
+            case 's':
+                id = (uint32_t) strtoul(optarg, NULL, 10);
+                break;
+
+            default:
+                partner_sim_usage();
+                return EXIT_FAILURE;
+        }
+    }
+
+    S7Object partner = Par_Create(0);
+
+    if(Par_StartTo(
+        partner
+        , local
+        , remote
+        , PARTNER_REMOTE_TSAP
+        , PARTNER_LOCAL_TSAP) != 0)
+    {
+        fprintf(stderr, "Error during starting partner stand-in!\n");
+        Par_Destroy(&partner);
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stdout, "Waiting for csv_maker partner %s...\n", remote);
+    fflush(stdout);
+
+    int status = par_stopped;
+    const struct timespec poll = {.tv_nsec = 100000000L};
+
+    while(Par_GetStatus(partner, &status) == 0 && status != par_linked)
+        nanosleep(&poll, NULL);
+
+    LatencyHistogram latency;
+    long failed = 0;
+
+    latency_histogram_init(&latency);
+
+    for(long i = 0; i < count; i++, id++)
+    {
+        char db[DB_GLASS_STRUCT_SIZE];
+        longword r_id = 0;
+        int size = 0;
+
+        build_record(db, id, time(NULL));
+
+        uint64_t start = rt_now_ns();
+        int error =
+            Par_BSend(partner, PARTNER_GLASS_R_ID, db, sizeof(db));
+
+        if(error == 0)
+            error =
+                Par_BRecv(
+                    partner
+                    , &r_id
+                    , ack
+                    , &size
+                    , PARTNER_RECV_TIMEOUT_MS);
+
+        uint64_t elapsed = rt_now_ns() - start;
+        uint32_t acked = 0;
+
+        if(error == 0 && r_id == PARTNER_ACK_R_ID && size >= PARTNER_ACK_SIZE)
+        {
+            memcpy(&acked, ack + 1, 4);
+            acked = swap_endian_int32(acked);
+        }
+        else
+            error = error != 0 ? error : -1;
+
+        if(error != 0 || acked != id)
+        {
+            fprintf(stderr, "Glass %u not acknowledged!\n", (unsigned) id);
+            failed++;
+        }
+        else
+        {
+            latency_histogram_add(&latency, elapsed);
+            fprintf(
+                stdout
+                , "Glass %u: %s%s in %llu us.\n"
+                , (unsigned) id
+                , (ack[0] & 0x01) ? "success" : "failed"
+                , (ack[0] & 0x04) ? ", rejected" : ""
+                , (unsigned long long) (elapsed / 1000));
+        }
+
+        fflush(stdout);
+
+        const struct timespec pause =
+            {.tv_sec = interval_ms / 1000
+            , .tv_nsec = (interval_ms % 1000) * 1000000L};
+        nanosleep(&pause, NULL);
+    }
+
+    latency_histogram_print(&latency, "Push to ack", stdout);
+    fprintf(stdout, "%ld of %ld glasses not acknowledged.\n", failed, count);
+
+    Par_Stop(partner);
+    Par_Destroy(&partner);
+
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,495 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <snap7.h>
+
+#include "sampler.h"
+#include "settings.h"
+
+
+bool
+sampler_add_channel(
+    Sampler * sampler
+    , const char * spec)
+{
+    SamplerChannel channel;
+    char type;
+    int length = 0;
+
+    if(sampler->channel_count >= TS_MAX_CHANNELS
+        || sscanf(
+            spec
+            , "DB%d.DB%c%d%n"
+            , &channel.db
+            , &type
+            , &channel.start
+            , &length) != 3
+        || spec[length] != '\0'
+        || channel.db <= 0
+        || channel.start < 0)
+        return false;
+
+    switch(type)
+    {
+        case 'D':
+            channel.type = ChannelReal;
+            break;
+
+        case 'W':
+            channel.type = ChannelInt;
+            break;
+
+        case 'B':
+            channel.type = ChannelByte;
+            break;
+
+        default:
+            return false;
+    }
+
+    sampler->channels[sampler->channel_count++] = channel;
+
+    return true;
+}
+
+
+/*
+** Word length of snap7 read request for channel, snap7 constants need not
+** be integer constant expressions, so they are not used as case labels
+*/
+static int
+channel_word_len(const SamplerChannel * channel)
+{
+    if(channel->type == ChannelReal)
+        return S7WLReal;
+    else if(channel->type == ChannelInt)
+        return S7WLWord;
+    else
+        return S7WLByte;
+}
+
+
+/*
+** Conversion of raw big endian PLC value into float
+*/
+static float
+channel_value(
+    const SamplerChannel * channel
+    , const uint8_t raw[4])
+{
+    switch(channel->type)
+    {
+        case ChannelReal:
+        {
+            uint32_t bits;
+            float value;
+
+            memcpy(&bits, raw, 4);
+            bits = swap_endian_int32(bits);
+            memcpy(&value, &bits, 4);
+
+            return value;
+        }
+
+        case ChannelInt:
+        {
+            uint16_t bits;
+
+            memcpy(&bits, raw, 2);
+
+            return (float) (int16_t) swap_endian_int16(bits);
+        }
+
+        default:
+            return (float) raw[0];
+    }
+}
+
+
+static int64_t
+realtime_us(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+
+/*
+** Sample thread, it reconnects whenever reading fails
+*/
+static void *
+sample_thread(void * argument)
+{
+    Sampler * sampler = argument;
+    S7Object plc = Cli_Create();
+    TS7DataItem items[TS_MAX_CHANNELS];
+    uint8_t raw[TS_MAX_CHANNELS][4];
+    bool connected = false;
+    RtCycle cycle;
+
+    for(size_t c = 0; c < sampler->channel_count; c++)
+        items[c] = (TS7DataItem)
+            {.Area = S7AreaDB
+            , .WordLen = channel_word_len(&sampler->channels[c])
+            , .DBNumber = sampler->channels[c].db
+            , .Start = sampler->channels[c].start
+            , .Amount = 1
+            , .pdata = raw[c]};
+
+    rt_cycle_init(&cycle, sampler->period_ns);
+
+    while(true)
+    {
+        rt_cycle_wait(&cycle, NULL);
+
+        if(connected == false)
+        {
+            char address[CONFIG_ADDRESS_SIZE];
+            int rack;
+            int slot;
+
+            pthread_mutex_lock(&sampler->lock);
+            memcpy(address, sampler->address, sizeof(address));
+            rack = sampler->rack;
+            slot = sampler->slot;
+            sampler->reconnect = false;
+            pthread_mutex_unlock(&sampler->lock);
+
+            connected = Cli_ConnectTo(plc, address, rack, slot) == 0;
+
+            if(connected == false)
+            {
+                const struct timespec retry = {.tv_sec = 1};
+                nanosleep(&retry, NULL);
+                continue;
+            }
+        }
+
+        int64_t before = realtime_us();
+        int error =
+            Cli_ReadMultiVars(
+                plc
+                , items
+                , (int) sampler->channel_count);
+        int64_t after = realtime_us();
+
+        for(size_t c = 0; c < sampler->channel_count && error == 0; c++)
+            error = items[c].Result;
+
+        if(error != 0)
+        {
+            Cli_Disconnect(plc);
+            connected = false;
+            continue;
+        }
+
+        pthread_mutex_lock(&sampler->lock);
+
+        size_t slot = sampler->head % sampler->capacity;
+
+        sampler->times[slot] = before + (after - before) / 2;
+
+        for(size_t c = 0; c < sampler->channel_count; c++)
+            sampler->values[slot * sampler->channel_count + c] =
+                channel_value(&sampler->channels[c], raw[c]);
+
+        sampler->head++;
+        pthread_cond_signal(&sampler->wake);
+
+        if(sampler->reconnect == true)
+        {
+            Cli_Disconnect(plc);
+            connected = false;
+        }
+
+        pthread_mutex_unlock(&sampler->lock);
+    }
+
+    Cli_Destroy(&plc);
+
+    return NULL;
+}
+
+
+/*
+** Copying of samples of request out of history, lock is held by caller.
+** Returns number of copied samples.
+*/
+static size_t
+sampler_cut(
+    Sampler * sampler
+    , const CurveRequest * request
+    , int64_t * times
+    , float * values)
+{
+    uint64_t first =
+        sampler->head > sampler->capacity
+            ? sampler->head - sampler->capacity
+            : 0;
+    size_t count = 0;
+    size_t channels = sampler->channel_count;
+
+    for(uint64_t i = first; i < sampler->head; i++)
+    {
+        size_t slot = i % sampler->capacity;
+        int64_t t = sampler->times[slot];
+
+        if(t < request->start_us || t > request->end_us)
+            continue;
+
+        times[count] = t;
+        memcpy(
+            &values[count * channels]
+            , &sampler->values[slot * channels]
+            , channels * sizeof(values[0]));
+        count++;
+    }
+
+    return count;
+}
+
+
+/*
+** Store thread. Request waits until history contains sample after the end
+** of glue application or until its deadline passes.
+*/
+static void *
+store_thread(void * argument)
+{
+    Sampler * sampler = argument;
+    size_t channels = sampler->channel_count;
+    size_t bound = ts_encoded_bound(channels, sampler->capacity);
+    int64_t * times = malloc(sampler->capacity * sizeof(times[0]));
+    float * values = malloc(sampler->capacity * channels * sizeof(values[0]));
+    uint8_t * block = malloc(bound);
+
+    if(times == NULL || values == NULL || block == NULL)
+    {
+        fprintf(stderr, "Error during allocation of curve buffers!\n");
+        return NULL;
+    }
+
+    pthread_mutex_lock(&sampler->lock);
+
+    while(true)
+    {
+        while(sampler->request_count == 0)
+            pthread_cond_wait(&sampler->wake, &sampler->lock);
+
+        CurveRequest request = sampler->requests[0];
+        int64_t last =
+            sampler->head > 0
+                ? sampler->times[(sampler->head - 1) % sampler->capacity]
+                : 0;
+
+        if(last <= request.end_us && rt_now_ns() < request.deadline_ns)
+        {
+            // samples may stop while PLC is disconnected
+            struct timespec timeout;
+            clock_gettime(CLOCK_REALTIME, &timeout);
+            timeout.tv_sec++;
+
+            pthread_cond_timedwait(&sampler->wake, &sampler->lock, &timeout);
+            continue;
+        }
+
+        size_t count = sampler_cut(sampler, &request, times, values);
+        int64_t newest =
+            sampler->head > 0
+                ? sampler->times[(sampler->head - 1) % sampler->capacity]
+                : 0;
+
+        sampler->request_count--;
+        memmove(
+            &sampler->requests[0]
+            , &sampler->requests[1]
+            , sampler->request_count * sizeof(request));
+
+        pthread_mutex_unlock(&sampler->lock);
+
+        if(count == 0 && newest > 0)
+            fprintf(
+                stderr
+                , "Curve window of glass %u (%.1f s to %.1f s from the newest"
+                  " sample) misses all samples, PLC and PC clocks differ?\n"
+                , (unsigned) request.id
+                , (request.start_us - newest) / 1e6
+                , (request.end_us - newest) / 1e6);
+        else if(count == 0)
+            fprintf(
+                stderr
+                , "No curve samples for glass %u!\n"
+                , (unsigned) request.id);
+        else
+        {
+            size_t length =
+                ts_encode(
+                    request.id
+                    , channels
+                    , count
+                    , times
+                    , values
+                    , block
+                    , bound);
+
+            if(length == 0
+                || ts_store_append(
+                    &request.csv_maker
+                    , request.time
+                    , block
+                    , length) == false)
+                fprintf(stderr, "Error during writing curve file!\n");
+            else
+                fprintf(
+                    stdout
+                    , "Curves of glass %u stored (%zu samples, %zu bytes).\n"
+                    , (unsigned) request.id
+                    , count
+                    , length);
+        }
+
+        pthread_mutex_lock(&sampler->lock);
+    }
+
+    return NULL;
+}
+
+
+bool
+sampler_start(
+    Sampler * sampler
+    , const char * address
+    , int rack
+    , int slot
+    , unsigned rate_hz)
+{
+    if(sampler->channel_count == 0 || rate_hz == 0)
+        return false;
+
+    snprintf(sampler->address, sizeof(sampler->address), "%s", address);
+    sampler->rack = rack;
+    sampler->slot = slot;
+    sampler->reconnect = false;
+    sampler->period_ns = 1000000000L / rate_hz;
+    sampler->capacity = (size_t) rate_hz * SAMPLER_HISTORY_SECONDS;
+    sampler->times = calloc(sampler->capacity, sizeof(sampler->times[0]));
+    sampler->values =
+        calloc(
+            sampler->capacity * sampler->channel_count
+            , sizeof(sampler->values[0]));
+    sampler->head = 0;
+    sampler->plc_offset_us = 0;
+    sampler->reported_offset_us = 0;
+    sampler->request_count = 0;
+
+    if(sampler->times == NULL || sampler->values == NULL)
+        return false;
+
+    pthread_mutex_init(&sampler->lock, NULL);
+    pthread_cond_init(&sampler->wake, NULL);
+
+    return pthread_create(
+            &sampler->sample_thread
+            , NULL
+            , sample_thread
+            , sampler) == 0
+        && pthread_create(
+            &sampler->store_thread
+            , NULL
+            , store_thread
+            , sampler) == 0;
+}
+
+
+void
+sampler_set_plc(
+    Sampler * sampler
+    , const char * address
+    , int rack
+    , int slot)
+{
+    pthread_mutex_lock(&sampler->lock);
+
+    if(strcmp(sampler->address, address) != 0
+        || sampler->rack != rack
+        || sampler->slot != slot)
+    {
+        snprintf(sampler->address, sizeof(sampler->address), "%s", address);
+        sampler->rack = rack;
+        sampler->slot = slot;
+        sampler->reconnect = true;
+    }
+
+    pthread_mutex_unlock(&sampler->lock);
+}
+
+
+void
+sampler_request(
+    Sampler * sampler
+    , const CsvMaker * csv_maker
+    , const Glass * glass
+    , time_t now)
+{
+    int64_t start = dtl_to_unix_us(glass->glueStartApplicationTime);
+    int64_t end = dtl_to_unix_us(glass->glueEndApplicationTime);
+
+    if(start < 0 || end < start)
+    {
+        fprintf(
+            stderr
+            , "Invalid glue application time of glass %u!\n"
+            , (unsigned) glass->id);
+        return;
+    }
+
+    CurveRequest request =
+        {.id = glass->id
+        , .start_us = start - CURVE_MARGIN_MS * 1000
+        , .end_us = end + CURVE_MARGIN_MS * 1000
+        , .time = now
+        , .deadline_ns = rt_now_ns() + CURVE_WAIT_MS * 1000000ULL
+        , .csv_maker = *csv_maker};
+    int64_t assembly = dtl_to_unix_us(glass->assemblyTime);
+    int64_t limit = CURVE_CLOCK_SKEW_MS * 1000LL;
+
+    pthread_mutex_lock(&sampler->lock);
+
+    // request follows assembly, so smaller offset is delay of request
+    if(assembly >= 0)
+    {
+        int64_t offset = assembly - (int64_t) now * 1000000;
+
+        sampler->plc_offset_us = llabs(offset) > limit ? offset : 0;
+    }
+
+    if(llabs(sampler->plc_offset_us - sampler->reported_offset_us) > limit)
+    {
+        sampler->reported_offset_us = sampler->plc_offset_us;
+        fprintf(
+            stderr
+            , "PLC clock differs from PC clock by %.1f s, curve windows are"
+              " shifted!\n"
+            , sampler->plc_offset_us / 1e6);
+    }
+
+    request.start_us -= sampler->plc_offset_us;
+    request.end_us -= sampler->plc_offset_us;
+
+    if(sampler->request_count < SAMPLER_REQUESTS)
+    {
+        sampler->requests[sampler->request_count++] = request;
+        pthread_cond_signal(&sampler->wake);
+    }
+    else
+        fprintf(
+            stderr
+            , "Curve requests are full, glass %u skipped!\n"
+            , (unsigned) glass->id);
+
+    pthread_mutex_unlock(&sampler->lock);
+}
@@ -0,0 +1,138 @@
+#ifndef _SAMPLER_H_
+#define _SAMPLER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "csvmaker.h"
+
+
+/*
+** Number of pending curve requests
+*/
+#define SAMPLER_REQUESTS 16
+
+
+/*
+** Types of sampled values, they are mapped to snap7 word lengths only for
+** read requests
+*/
+typedef enum
+{
+    ChannelReal
+    , ChannelInt
+    , ChannelByte
+}ChannelType;
+
+
+/*
+** One sampled PLC address
+*/
+typedef struct
+{
+    int db;
+    int start;
+    ChannelType type;
+}SamplerChannel;
+
+
+/*
+** Request for storing of curves of one glass
+*/
+typedef struct
+{
+    uint32_t id;
+    int64_t start_us;
+    int64_t end_us;
+    time_t time;
+    uint64_t deadline_ns;
+    CsvMaker csv_maker;
+}CurveRequest;
+
+
+/*
+** Second acquisition channel for process curves.
+**
+** Sample thread has its own PLC connection and reads all channels with one
+** Cli_ReadMultiVars request every period into history ring of the last
+** SAMPLER_HISTORY_SECONDS. Store thread waits for requests of stored
+** glasses, cuts samples between glue application start and end out of
+** history and appends them as compressed block into daily curve file of
+** the cell which stored the glass, so neither of them delays request/ack
+** handshake of the main loop. PLC endpoint is guarded by lock, so it can
+** be changed by configuration reload. Samples have PC time, plc_offset_us
+** is applied to PLC times of curve window (see CURVE_CLOCK_SKEW_MS).
+*/
+typedef struct
+{
+    char address[CONFIG_ADDRESS_SIZE];
+    int rack;
+    int slot;
+    bool reconnect;
+    long period_ns;
+    SamplerChannel channels[TS_MAX_CHANNELS];
+    size_t channel_count;
+    size_t capacity;
+    int64_t * times;
+    float * values;
+    uint64_t head;
+    int64_t plc_offset_us;
+    int64_t reported_offset_us;
+    CurveRequest requests[SAMPLER_REQUESTS];
+    size_t request_count;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_t sample_thread;
+    pthread_t store_thread;
+}Sampler;
+
+
+/*
+** Adding of channel given as DB<n>.DBD<offset> (REAL), DB<n>.DBW<offset>
+** (INT) or DB<n>.DBB<offset> (BYTE)
+*/
+bool
+sampler_add_channel(
+    Sampler * sampler
+    , const char * spec);
+
+
+/*
+** Starting of sample and store threads
+*/
+bool
+sampler_start(
+    Sampler * sampler
+    , const char * address
+    , int rack
+    , int slot
+    , unsigned rate_hz);
+
+
+/*
+** Changing of PLC endpoint of running sampler, sample thread reconnects
+** when it differs
+*/
+void
+sampler_set_plc(
+    Sampler * sampler
+    , const char * address
+    , int rack
+    , int slot);
+
+
+/*
+** Queuing of curve request for glass stored into csv file of csv_maker,
+** it never blocks on I/O
+*/
+void
+sampler_request(
+    Sampler * sampler
+    , const CsvMaker * csv_maker
+    , const Glass * glass
+    , time_t now);
+
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef _SETTINGS_H_
+#define _SETTINGS_H_
+
+#include "csvmaker.h"
+
+
+/********************** configuration ************************/
+#define IP_ADDRESS "192.168.2.1"
+#define RACK 0
+#define SLOT 1
+#define DB_INDEX 18
+#define DB_PC_STATUS 288
+
+#define DEFAULT_CSV_PATH "./"
+#define CSV_NAME "Klebezelle"
+#define CSV_SEPARATOR ';'
+#define CSV_SYNC_INTERVAL 16
+
+/*
+** Defaults of cell configuration, command line options and configuration
+** file override them
+*/
+#define CELL_CONFIG_DEFAULTS                 \
+    {.name = CSV_NAME                        \
+    , .address = IP_ADDRESS                  \
+    , .rack = RACK                           \
+    , .slot = SLOT                           \
+    , .db = DB_INDEX                         \
+    , .status_offset = DB_PC_STATUS          \
+    , .poll_us = POLL_INTERVAL_US            \
+    , .cpu = -1                              \
+    , .path = DEFAULT_CSV_PATH               \
+    , .csv_name = CSV_NAME                   \
+    , .separator = CSV_SEPARATOR             \
+    , .backend = WriterPosix                 \
+    , .sync_interval = CSV_SYNC_INTERVAL}
+
+/*
+** Number of glass ids of the last csv appends, which are remembered for
+** reporting of failed asynchronous writes
+*/
+#define CSV_APPEND_HISTORY 64
+
+#define RING_SLOTS RING_DEFAULT_SLOTS
+
+#define SPOOL_MAX_RECORDS 500
+#define SPOOL_MAX_SECONDS (15 * 60)
+
+#define SUMMARY_HOUR_SECONDS 3600
+#define SUMMARY_SHIFT_SECONDS (8 * 3600)
+#define SUMMARY_SHIFT_OFFSET (6 * 3600)
+
+/*
+** Poll interval of request bit, it is cycle period in real-time mode
+*/
+#define POLL_INTERVAL_US 1000
+
+#define RT_PRIORITY 80
+#define RT_OUTPUT_IDLE_NS 1000000L
+#define RT_REPORT_SECONDS 300
+
+#define SAMPLER_RATE_HZ 100
+#define SAMPLER_HISTORY_SECONDS 120
+#define CURVE_MARGIN_MS 100
+#define CURVE_WAIT_MS 5000
+
+/*
+** Samples are stamped by PC clock, curve window by PLC clock. Offset of PLC
+** clock is estimated from assembly time of glass and time of its request,
+** larger offset than this is reported and applied to curve window.
+*/
+#define CURVE_CLOCK_SKEW_MS 2000
+
+/*
+** Partner transport: PLC sends glass record (DB_GLASS_STRUCT_SIZE bytes)
+** by BSEND with R_ID PARTNER_GLASS_R_ID, PC answers by BSEND with R_ID
+** PARTNER_ACK_R_ID and PARTNER_ACK_SIZE bytes: PC status byte followed by
+** glass id (big endian)
+*/
+#define PARTNER_LOCAL_ADDRESS "0.0.0.0"
+#define PARTNER_LOCAL_TSAP 0x1002
+#define PARTNER_REMOTE_TSAP 0x1002
+#define PARTNER_GLASS_R_ID 1
+#define PARTNER_ACK_R_ID 2
+#define PARTNER_ACK_SIZE 5
+#define PARTNER_BUFFER_SIZE 65536
+#define PARTNER_RECV_TIMEOUT_MS 1000
+
+
+#endif
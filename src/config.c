@@ -0,0 +1,431 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+
+#include "config.h"
+#include "glass.h"
+
+
+/*
+** Removing of white space from both ends of string
+*/
+static char *
+trim(char * text)
+{
+    while(isspace((unsigned char) *text))
+        text++;
+
+    size_t length = strlen(text);
+
+    while(length > 0 && isspace((unsigned char) text[length - 1]))
+        text[--length] = '\0';
+
+    return text;
+}
+
+
+static bool
+copy_string(
+    char * target
+    , size_t size
+    , const char * value)
+{
+    int length = snprintf(target, size, "%s", value);
+
+    return length >= 0 && (size_t) length < size;
+}
+
+
+static bool
+parse_long(
+    const char * value
+    , long minimum
+    , long maximum
+    , long * result)
+{
+    char * end;
+
+    errno = 0;
+    *result = strtol(value, &end, 0);
+
+    return errno == 0
+        && end != value
+        && *end == '\0'
+        && *result >= minimum
+        && *result <= maximum;
+}
+
+
+static bool
+parse_int(
+    const char * value
+    , int minimum
+    , int maximum
+    , int * result)
+{
+    long number;
+
+    if(parse_long(value, minimum, maximum, &number) == false)
+        return false;
+
+    *result = (int) number;
+
+    return true;
+}
+
+
+static bool
+parse_bool(
+    const char * value
+    , bool * result)
+{
+    if(strcmp(value, "yes") == 0
+        || strcmp(value, "true") == 0
+        || strcmp(value, "1") == 0)
+        *result = true;
+    else if(strcmp(value, "no") == 0
+        || strcmp(value, "false") == 0
+        || strcmp(value, "0") == 0)
+        *result = false;
+    else
+        return false;
+
+    return true;
+}
+
+
+/*
+** Setting of one key of cell, returns error message or NULL
+*/
+static const char *
+set_key(
+    CellConfig * cell
+    , const char * key
+    , const char * value)
+{
+    long number;
+
+    if(strcmp(key, "address") == 0)
+        return copy_string(cell->address, sizeof(cell->address), value)
+            ? NULL : "address too long";
+
+    if(strcmp(key, "rack") == 0)
+        return parse_int(value, 0, 7, &cell->rack)
+            ? NULL : "rack must be 0 to 7";
+
+    if(strcmp(key, "slot") == 0)
+        return parse_int(value, 0, 31, &cell->slot)
+            ? NULL : "slot must be 0 to 31";
+
+    if(strcmp(key, "db") == 0)
+        return parse_int(value, 1, 65535, &cell->db)
+            ? NULL : "db must be 1 to 65535";
+
+    if(strcmp(key, "status_offset") == 0)
+        return parse_int(value, 0, 65535, &cell->status_offset)
+            ? NULL : "status_offset must be 0 to 65535";
+
+    if(strcmp(key, "poll_us") == 0)
+        return parse_long(value, 0, 10000000, &cell->poll_us)
+            ? NULL : "poll_us must be 0 to 10000000";
+
+    if(strcmp(key, "cpu") == 0)
+        return parse_int(value, -1, 1023, &cell->cpu)
+            ? NULL : "cpu must be -1 to 1023";
+
+    if(strcmp(key, "path") == 0)
+        return copy_string(cell->path, sizeof(cell->path), value)
+            ? NULL : "path too long";
+
+    if(strcmp(key, "name") == 0)
+        return copy_string(cell->csv_name, sizeof(cell->csv_name), value)
+            ? NULL : "name too long";
+
+    if(strcmp(key, "separator") == 0)
+    {
+        if(strlen(value) != 1)
+            return "separator must be one character";
+
+        cell->separator = value[0];
+        return NULL;
+    }
+
+    if(strcmp(key, "writer") == 0)
+    {
+        if(strcmp(value, "posix") == 0)
+            cell->backend = WriterPosix;
+        else if(strcmp(value, "uring") == 0)
+            cell->backend = WriterUring;
+        else
+            return "writer must be posix or uring";
+
+        return NULL;
+    }
+
+    if(strcmp(key, "sync_interval") == 0)
+    {
+        if(parse_long(value, 0, 1000000, &number) == false)
+            return "sync_interval must be 0 to 1000000";
+
+        cell->sync_interval = (unsigned) number;
+        return NULL;
+    }
+
+    if(strcmp(key, "ring") == 0)
+        return copy_string(cell->ring, sizeof(cell->ring), value)
+            ? NULL : "ring too long";
+
+    if(strcmp(key, "outbox") == 0)
+        return copy_string(cell->outbox, sizeof(cell->outbox), value)
+            ? NULL : "outbox too long";
+
+    if(strcmp(key, "summary") == 0)
+        return parse_bool(value, &cell->summary)
+            ? NULL : "summary must be yes or no";
+
+    if(strcmp(key, "rules") == 0)
+        return copy_string(cell->rules, sizeof(cell->rules), value)
+            ? NULL : "rules too long";
+
+    if(strcmp(key, "partner") == 0)
+        return copy_string(cell->partner, sizeof(cell->partner), value)
+            ? NULL : "partner too long";
+
+    return "unknown key";
+}
+
+
+bool
+cell_config_validate(
+    const CellConfig * cell
+    , char * error
+    , size_t error_size)
+{
+    const char * message = NULL;
+
+    if(cell->address[0] == '\0' && cell->partner[0] == '\0')
+        message = "address is missing";
+    else if(cell->status_offset < DB_GLASS_STRUCT_SIZE)
+        message = "status_offset overlaps glass record";
+    else if(cell->csv_name[0] == '\0')
+        message = "name is missing";
+    else if(strchr(cell->csv_name, '/') != NULL)
+        message = "name must not contain /";
+    else if(is_path_valid(cell->path) == false)
+        message = "path does not exist";
+    else if(cell->separator == '\n'
+        || cell->separator == '\r'
+        || cell->separator == '"')
+        message = "invalid separator";
+
+    if(message == NULL)
+        return true;
+
+    snprintf(error, error_size, "cell %s: %s", cell->name, message);
+
+    return false;
+}
+
+
+bool
+config_parse(
+    Config * config
+    , const char * text
+    , const CellConfig * defaults
+    , char * error
+    , size_t error_size)
+{
+    CellConfig common = *defaults;
+    CellConfig * cell = &common;
+    char line[CSV_PATH_SIZE + 64];
+    size_t number = 0;
+
+    config->cell_count = 0;
+
+    while(*text != '\0')
+    {
+        size_t length = strcspn(text, "\n");
+        const char * message = NULL;
+
+        number++;
+
+        if(length >= sizeof(line))
+            message = "line too long";
+        else
+        {
+            memcpy(line, text, length);
+            line[length] = '\0';
+
+            char * content = trim(line);
+
+            if(*content == '\0' || *content == '#' || *content == ';')
+                ;
+            else if(*content == '[')
+            {
+                char * end = strchr(content, ']');
+                char name[CONFIG_NAME_SIZE];
+                int name_length = 0;
+
+                if(end == NULL || end[1] != '\0')
+                    message = "invalid section";
+                else if(sscanf(content, "[cell %31[^] ]]%n", name, &name_length)
+                        != 1
+                    || content[name_length] != '\0')
+                    message = "expected [cell <name>]";
+                else if(config_find(config, name) != NULL)
+                    message = "duplicate cell";
+                else if(config->cell_count >= CONFIG_MAX_CELLS)
+                    message = "too many cells";
+                else
+                {
+                    cell = &config->cells[config->cell_count++];
+                    *cell = common;
+                    snprintf(cell->name, sizeof(cell->name), "%s", name);
+                }
+            }
+            else
+            {
+                char * value = strchr(content, '=');
+
+                if(value == NULL)
+                    message = "expected key = value";
+                else
+                {
+                    *value++ = '\0';
+                    message = set_key(cell, trim(content), trim(value));
+                }
+            }
+        }
+
+        if(message != NULL)
+        {
+            snprintf(error, error_size, "line %zu: %s", number, message);
+            return false;
+        }
+
+        text += length;
+
+        if(*text == '\n')
+            text++;
+    }
+
+    if(config->cell_count == 0)
+    {
+        snprintf(error, error_size, "no cell configured");
+        return false;
+    }
+
+    for(size_t i = 0; i < config->cell_count; i++)
+    {
+        const CellConfig * a = &config->cells[i];
+
+        if(cell_config_validate(a, error, error_size) == false)
+            return false;
+
+        for(size_t j = 0; j < i; j++)
+        {
+            const CellConfig * b = &config->cells[j];
+            const char * message = NULL;
+
+            if(strcmp(a->path, b->path) == 0
+                && strcmp(a->csv_name, b->csv_name) == 0)
+                message = "same csv file";
+            else if(a->ring[0] != '\0' && strcmp(a->ring, b->ring) == 0)
+                message = "same ring";
+            else if(a->outbox[0] != '\0' && strcmp(a->outbox, b->outbox) == 0)
+                message = "same outbox";
+            else if(a->cpu >= 0 && a->cpu == b->cpu)
+                message = "same cpu";
+
+            if(message != NULL)
+            {
+                snprintf(
+                    error
+                    , error_size
+                    , "cells %s and %s: %s"
+                    , b->name
+                    , a->name
+                    , message);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+bool
+config_load(
+    Config * config
+    , const char * path
+    , const CellConfig * defaults
+    , char * error
+    , size_t error_size)
+{
+    FILE * file = fopen(path, "r");
+
+    if(file == NULL)
+    {
+        snprintf(error, error_size, "cannot open %s", path);
+        return false;
+    }
+
+    // one byte more than fits is read to detect too long file
+    char text[65536 + 1];
+    size_t length = fread(text, 1, sizeof(text), file);
+
+    fclose(file);
+
+    if(length == sizeof(text))
+    {
+        snprintf(error, error_size, "%s is too long", path);
+        return false;
+    }
+
+    text[length] = '\0';
+
+    return config_parse(config, text, defaults, error, error_size);
+}
+
+
+const CellConfig *
+config_find(
+    const Config * config
+    , const char * name)
+{
+    for(size_t i = 0; i < config->cell_count; i++)
+        if(strcmp(config->cells[i].name, name) == 0)
+            return &config->cells[i];
+
+    return NULL;
+}
+
+
+bool
+cell_config_same_connection(
+    const CellConfig * a
+    , const CellConfig * b)
+{
+    return strcmp(a->address, b->address) == 0
+        && a->rack == b->rack
+        && a->slot == b->slot
+        && strcmp(a->partner, b->partner) == 0;
+}
+
+
+bool
+cell_config_same_csv(
+    const CellConfig * a
+    , const CellConfig * b)
+{
+    return strcmp(a->path, b->path) == 0
+        && strcmp(a->csv_name, b->csv_name) == 0
+        && a->separator == b->separator
+        && a->backend == b->backend
+        && a->sync_interval == b->sync_interval;
+}
@@ -0,0 +1,144 @@
+#ifndef _CONFIG_H_
+#define _CONFIG_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "csv.h"
+#include "writer.h"
+
+
+/*
+** Configuration file of production cells.
+**
+** File has ini format. Every cell is section [cell <name>], keys before
+** the first section are defaults of all cells. Lines starting with # or ;
+** are comments.
+**
+**   writer = uring
+**
+**   [cell Klebezelle]
+**   address = 192.168.2.1
+**   rack = 0
+**   slot = 1
+**   db = 18
+**   status_offset = 288
+**   poll_us = 1000
+**   cpu = 2
+**   path = /data/csv
+**   name = Klebezelle
+**   separator = ;
+**   sync_interval = 16
+**   ring = /csv_maker
+**   outbox = /data/outbox
+**   summary = yes
+**   rules = /etc/csv_maker/rules
+**   partner = 192.168.2.1
+**
+** Empty ring, outbox, rules and partner disable the output or feature,
+** partner enables partner transport instead of polling of request bit.
+** cpu pins real-time acquisition loop of the cell, -1 disables pinning,
+** two cells can not share one cpu.
+*/
+#define CONFIG_MAX_CELLS 16
+#define CONFIG_NAME_SIZE 32
+#define CONFIG_ADDRESS_SIZE 64
+
+
+/*
+** Configuration of one cell
+*/
+typedef struct
+{
+    char name[CONFIG_NAME_SIZE];
+    char address[CONFIG_ADDRESS_SIZE];
+    int rack;
+    int slot;
+    int db;
+    int status_offset;
+    long poll_us;
+    int cpu;
+    char path[CSV_PATH_SIZE];
+    char csv_name[CSV_NAME_SIZE];
+    char separator;
+    WriterBackend backend;
+    unsigned sync_interval;
+    char ring[CONFIG_ADDRESS_SIZE];
+    char outbox[CSV_PATH_SIZE];
+    bool summary;
+    char rules[CSV_PATH_SIZE];
+    char partner[CONFIG_ADDRESS_SIZE];
+}CellConfig;
+
+
+/*
+** Configuration of all cells
+*/
+typedef struct
+{
+    size_t cell_count;
+    CellConfig cells[CONFIG_MAX_CELLS];
+}Config;
+
+
+/*
+** Parsing and validation of configuration text. Cells start from
+** defaults. Error message with line number is written into error buffer
+** when configuration is not valid.
+*/
+bool
+config_parse(
+    Config * config
+    , const char * text
+    , const CellConfig * defaults
+    , char * error
+    , size_t error_size);
+
+
+/*
+** Loading of configuration file
+*/
+bool
+config_load(
+    Config * config
+    , const char * path
+    , const CellConfig * defaults
+    , char * error
+    , size_t error_size);
+
+
+/*
+** Validation of one cell configuration
+*/
+bool
+cell_config_validate(
+    const CellConfig * cell
+    , char * error
+    , size_t error_size);
+
+
+const CellConfig *
+config_find(
+    const Config * config
+    , const char * name);
+
+
+/*
+** Comparison of settings which need new PLC connection
+*/
+bool
+cell_config_same_connection(
+    const CellConfig * a
+    , const CellConfig * b);
+
+
+/*
+** Comparison of settings of csv file which need reopening of the file
+*/
+bool
+cell_config_same_csv(
+    const CellConfig * a
+    , const CellConfig * b);
+
+
+#endif
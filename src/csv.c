@@ -0,0 +1,384 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "csv.h"
+
+
+const char * const csv_header[CSV_COLUMNS][2] =
+{
+    {"JobNummer", ""}
+    , {"AuftragsNr", ""}
+    , {"ScheibenType", ""}
+    , {"FahrzeugModell", ""}
+    , {"ScheibenNr", ""}
+    , {"TS_PrimerAuftrag", "Datum / Uhrzeit"}
+    , {"PrimerDetektiert", "true/false/NaN"}
+    , {"PrimerDetektiertZones", "true/false/NaN"}
+    , {"TS_PrimerAbgetrocknet", "Datum / Uhrzeit"}
+    , {"TI_PrimerAufgebrachtBisKleberaupe", "s"}
+    , {"Lagerfach", ""}
+    , {"TS_LetzteSpuelungMischer", "Datum / Uhrzeit"}
+    , {"TS_KleberaupeStart", "Datum / Uhrzeit"}
+    , {"TS_KleberaupeFertig", "Datum / Uhrzeit"}
+    , {"Kleberaubenerkennung", "true/false/NaN"}
+    , {"Metralight-Ergebnis umgangen", "true/false/NaN"}
+    , {"MetralightZone1", "true/false/NaN"}
+    , {"MetralightZone2", "true/false/NaN"}
+    , {"MetralightZone3", "true/false/NaN"}
+    , {"MetralightZone4", "true/false/NaN"}
+    , {"MetralightZone5", "true/false/NaN"}
+    , {"MetralightZone6", "true/false/NaN"}
+    , {"MetralightZone7", "true/false/NaN"}
+    , {"MetralightZone8", "true/false/NaN"}
+    , {"MetralightZone9", "true/false/NaN"}
+    , {"MetralightZone10", "true/false/NaN"}
+    , {"MetralightZone11", "true/false/NaN"}
+    , {"MetralightZone12", "true/false/NaN"}
+    , {"TI_KleberaupeFertigBisScheibeEndnommen", "s"}
+    , {"KomponenteA_Unabgelaufen", "true/false"}
+    , {"KomponenteA_BatchId", ""}
+    , {"KomponenteA_SerienNr", ""}
+    , {"KomponenteA_Menge", "ml"}
+    , {"AppizierdueseTempMin", "°C"}
+    , {"AppizierdueseTempAktuell", "°C"}
+    , {"AppizierdueseTempMax", "°C"}
+    , {"KomponenteA_TempMin", "°C"}
+    , {"KomponenteA_TempAktuell", "°C"}
+    , {"KomponenteA_TempMax", "°C"}
+    , {"KomponenteB_Unabgelaufen", "true/false"}
+    , {"KomponenteB_BatchId", ""}
+    , {"KomponenteB_SerienNr", ""}
+    , {"KomponenteB_Menge", "ml"}
+    , {"MischungsverhaeltnisKomponenten", ""}
+    , {"MischerrohrLebensdauerVerbleibend", "s"}
+    , {"RoboterZyklusOhneFehler", "true/false"}
+    , {"DosiereinheitOhneFehler", "true/false"}
+    , {"DrehtischOhneFehler", "true/false"}
+    , {"KleberaupenauftragOhneFehler", "true/false"}
+};
+
+
+/*
+** Buffer owned by caller into which csv line is formated field by field
+*/
+typedef struct
+{
+    char * buffer;
+    size_t size;
+    size_t length;
+    size_t fields;
+    char separator;
+    bool overflow;
+}CsvLine;
+
+
+/*
+** Appending of formated text at the end of line
+*/
+static void
+line_append(
+    CsvLine * line
+    , const char * format
+    , ...)
+{
+    if(line->overflow == true)
+        return;
+
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(
+        line->buffer + line->length
+        , line->size - line->length
+        , format
+        , args);
+    va_end(args);
+
+    if(n < 0 || (size_t) n >= line->size - line->length)
+        line->overflow = true;
+    else
+        line->length += (size_t) n;
+}
+
+
+/*
+** Appending of new field, separator is written in front of all fields
+** except the first one
+*/
+#define line_field(line, ...)                                 \
+    do                                                        \
+    {                                                         \
+        if((line)->fields++ > 0)                              \
+            line_append((line), "%c", (line)->separator);     \
+        line_append((line), __VA_ARGS__);                     \
+    }while(0)
+
+
+#define line_bool(line, value) \
+    line_field(line, "%s", (value) ? "true" : "false")
+
+
+#define line_dtl(line, dtl)              \
+    line_field(                          \
+        line                             \
+        , CSV_DTL_FORMAT                 \
+        , (dtl).YEAR                     \
+        , (dtl).MONTH                    \
+        , (dtl).DAY                      \
+        , (dtl).HOUR                     \
+        , (dtl).MINUTE                   \
+        , (dtl).SECOND)
+
+
+static size_t
+line_finish(CsvLine * line)
+{
+    return line->overflow ? 0 : line->length;
+}
+
+
+void
+csv_maker_init(
+    CsvMaker * csv_maker
+    , const char * path
+    , const char * name
+    , char separator)
+{
+    snprintf(csv_maker->path, sizeof(csv_maker->path), "%s", path);
+    snprintf(csv_maker->name, sizeof(csv_maker->name), "%s", name);
+    csv_maker->separator = separator;
+}
+
+
+char *
+time_string(
+    const char * format
+    , char * buffer
+    , size_t size)
+{
+	time_t my_time;
+	struct tm time_info;
+
+	time(&my_time);
+	localtime_r(&my_time, &time_info);
+
+	if(strftime(buffer, size, format, &time_info) == 0 && size > 0)
+      buffer[0] = '\0';
+
+	return buffer;
+}
+
+
+bool
+is_path_valid(const char * path)
+{
+	if(access(path, F_OK) != 0)
+	{
+		if(errno == ENOENT
+      || errno == ENOTDIR)
+			return false;
+	}
+
+	return true;
+}
+
+
+char *
+generate_csv_name(
+    const CsvMaker * csv_maker
+    , time_t t
+    , char * buffer
+    , size_t size)
+{
+  	struct tm tm;
+    localtime_r(&t, &tm);
+
+    snprintf(
+        buffer
+        , size
+        , "%s/%s-%d-%02d-%02d.csv"
+        , csv_maker->path
+        , csv_maker->name
+        , tm.tm_year + 1900
+        , tm.tm_mon + 1
+        , tm.tm_mday);
+
+    return buffer;
+}
+
+
+/*
+** Function for formating part of csv header (names or units)
+*/
+static void
+format_csv_header_items(
+  CsvLine * line
+  , int item_index)
+{
+    line->fields = 0;
+
+    for(size_t i = 0; i < CSV_COLUMNS; i++)
+        line_field(line, "%s", csv_header[i][item_index]);
+}
+
+
+size_t
+format_csv_header(
+    const CsvMaker * csv_maker
+    , char * buffer
+    , size_t size)
+{
+    CsvLine line =
+        {.buffer = buffer
+        , .size = size
+        , .separator = csv_maker->separator};
+
+    format_csv_header_items(&line, 0);
+    line_append(&line, "\n");
+    format_csv_header_items(&line, 1);
+    line_append(&line, "\n");
+
+    return line_finish(&line);
+}
+
+
+size_t
+format_csv_line(
+    const CsvMaker * csv_maker
+    , const Glass * glass
+    , char * buffer
+    , size_t size)
+{
+    CsvLine line =
+        {.buffer = buffer
+        , .size = size
+        , .separator = csv_maker->separator};
+
+    line_field(&line, "%s", glass->jobNr);
+    line_field(&line, "%s", glass->vehicleNumber);
+    line_field(&line, "%s", glass->rearWindow);
+    line_field(&line, "%s", vehicle_model_to_string(glass->vehicleModel));
+    line_field(&line, "%u", (unsigned) glass->id);
+
+    if(glass->primerAppEnable == true)
+      line_dtl(&line, glass->primerApplicationTime);
+    else
+      line_field(&line, "NaN");
+
+    if(glass->primerInspectionEnable == true)
+      line_bool(&line, glass->primerInspectionResult);
+    else
+      line_field(&line, "NaN");
+
+    if(glass->primerInspectionEnable == true)
+      line_field(
+        &line
+        , "%s-%s-%s-%s"
+        , (glass->zones.zone1 ? "true" : "false")
+        , (glass->zones.zone2 ? "true" : "false")
+        , (glass->zones.zone3 ? "true" : "false")
+        , (glass->zones.zone4 ? "true" : "false"));
+    else
+      line_field(&line, "NaN");
+
+    if(glass->primerAppEnable == true)
+      line_dtl(&line, glass->primerFlashoffTime);
+    else
+      line_field(&line, "NaN");
+
+    // interval from primer application to start of glue application
+    if(glass->primerAppEnable == true)
+      line_field(
+        &line
+        , "%lld"
+        , (long long) (dtl_to_seconds(glass->glueStartApplicationTime)
+          - dtl_to_seconds(glass->primerApplicationTime)));
+    else
+      line_field(&line, "NaN");
+
+    line_field(&line, "%d", glass->drawerIndex);
+    line_dtl(&line, glass->timeSinceLastDispense);
+    line_dtl(&line, glass->glueStartApplicationTime);
+    line_dtl(&line, glass->glueEndApplicationTime);
+
+    if(glass->metralightEn == true)
+      line_bool(&line, glass->glueApplicationResult);
+    else
+      line_field(&line, "NaN");
+
+    if(glass->metralightEn == true)
+      line_bool(&line, glass->glueInspectionBypass);
+    else
+      line_field(&line, "NaN");
+
+    for(int i = 0; i < 12; i++)
+    {
+      if(glass->metralightEn == true)
+        line_bool(&line, glass->metralightZone[i] == MetralightOK);
+      else
+        line_field(&line, "NaN");
+    }
+
+    line_field(
+      &line
+      , "%lld"
+      , (long long) (dtl_to_seconds(glass->assemblyTime)
+        - dtl_to_seconds(glass->glueEndApplicationTime)));
+
+    line_bool(&line, glass->A.expiration);
+    line_field(&line, "%s", glass->A.batchNumber);
+    line_field(&line, "%s", glass->A.serialNumber);
+    line_field(&line, "%f", glass->aAppliedGlueAmount);
+    line_field(&line, "%d", glass->pistolTemperatureMin);
+    line_field(&line, "%f", glass->pistolTempDuringApp);
+    line_field(&line, "%d", glass->pistolTemperatureMax);
+    line_field(&line, "%d", glass->aPotTemperatureMin);
+    line_field(&line, "%f", glass->aPotTempDuringApp);
+    line_field(&line, "%d", glass->aPotTemperatureMax);
+    line_bool(&line, glass->B.expiration);
+    line_field(&line, "%s", glass->B.batchNumber);
+    line_field(&line, "%s", glass->B.serialNumber);
+    line_field(&line, "%f", glass->bAppliedGlueAmount);
+    line_field(
+      &line
+      , "%f:%f"
+      , glass->aApplicationRatio
+      , glass->bApplicationRatio);
+    line_field(&line, "%d", (int) glass->mixerTubeLife);
+    line_bool(&line, glass->robotCompleteSuccess);
+    line_bool(&line, glass->dispenseCompleteSuccess);
+    line_bool(&line, glass->rotaryUniteCompleteSucces);
+    line_bool(&line, glass->addhesiveProcessComplete);
+    line_append(&line, "\n");
+
+    return line_finish(&line);
+}
+
+
+bool
+store_csv_line(
+    const CsvMaker * csv_maker
+    , FILE * csv
+    , const Glass * glass
+    , bool write_header)
+{
+    char buffer[CSV_LINE_SIZE];
+    size_t length;
+
+    if(write_header == true)
+    {
+      length = format_csv_header(csv_maker, buffer, sizeof(buffer));
+
+      if(length == 0
+        || fwrite(buffer, 1, length, csv) != length)
+        return false;
+    }
+
+    length = format_csv_line(csv_maker, glass, buffer, sizeof(buffer));
+
+    return length > 0
+      && fwrite(buffer, 1, length, csv) == length;
+}
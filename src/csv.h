@@ -0,0 +1,128 @@
+#ifndef _CSV_H_
+#define _CSV_H_
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "glass.h"
+
+
+/*
+** Number of columns in csv file
+*/
+#define CSV_COLUMNS 49
+
+/*
+** Sizes of caller owned buffers
+*/
+#define CSV_PATH_SIZE 513
+#define CSV_NAME_SIZE 64
+#define CSV_LINE_SIZE 2048
+#define CSV_HEADER_SIZE 2048
+
+/*
+** Format of DTL timestamps in csv file, fields are year, month, day, hour,
+** minute and second
+*/
+#define CSV_DTL_FORMAT "%d-%02d-%02d %02d:%02d:%02d"
+
+
+/*
+** Context of csv output with path of directory, prefix of file name and
+** column separator. It is owned by caller and is never modified by
+** library functions, so one context can be shared between threads.
+*/
+typedef struct
+{
+    char path[CSV_PATH_SIZE];
+    char name[CSV_NAME_SIZE];
+    char separator;
+}CsvMaker;
+
+
+/*
+** Constants for csv header, pairs of column name and unit
+*/
+extern const char * const csv_header[CSV_COLUMNS][2];
+
+
+/*
+** Initialization of csv context
+*/
+void
+csv_maker_init(
+    CsvMaker * csv_maker
+    , const char * path
+    , const char * name
+    , char separator);
+
+
+/*
+** Function which writes current time in given format into given buffer.
+** Returns buffer.
+*/
+char *
+time_string(
+    const char * format
+    , char * buffer
+    , size_t size);
+
+
+/*
+** This function check if the given path in file system is valid
+*/
+bool
+is_path_valid(const char * path);
+
+
+/*
+** Function for generation of output csv file name with address for
+** storing based on context and given time. Name is written into buffer
+** owned by caller. Returns buffer.
+*/
+char *
+generate_csv_name(
+    const CsvMaker * csv_maker
+    , time_t t
+    , char * buffer
+    , size_t size);
+
+
+/*
+** Function for formating whole csv header (names and units) into given
+** buffer. Both lines are terminated by new line. Returns number of
+** written characters or 0 when buffer is too small.
+*/
+size_t
+format_csv_header(
+    const CsvMaker * csv_maker
+    , char * buffer
+    , size_t size);
+
+
+/*
+** Function for formating csv line terminated by new line from given Glass
+** structure into given buffer. Returns number of written characters or 0
+** when buffer is too small.
+*/
+size_t
+format_csv_line(
+    const CsvMaker * csv_maker
+    , const Glass * glass
+    , char * buffer
+    , size_t size);
+
+
+/*
+** Function for writing new csv line into csv file from given Glass structure
+*/
+bool
+store_csv_line(
+    const CsvMaker * csv_maker
+    , FILE * csv
+    , const Glass * glass
+    , bool write_header);
+
+
+#endif
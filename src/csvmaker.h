@@ -0,0 +1,23 @@
+#ifndef _CSVMAKER_H_
+#define _CSVMAKER_H_
+
+/*
+** Public interface of libcsvmaker. All functions are reentrant, results
+** are written into structures and buffers owned by caller.
+*/
+#include "glass.h"
+#include "glass_view.h"
+#include "csv.h"
+#include "ring.h"
+#include "stats.h"
+#include "writer.h"
+#include "recover.h"
+#include "export.h"
+#include "spool.h"
+#include "rt.h"
+#include "tsstore.h"
+#include "rules.h"
+#include "config.h"
+
+
+#endif
@@ -0,0 +1,588 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "export.h"
+
+
+/*
+** Columns used by export itself
+*/
+#define EXPORT_ID_COLUMN 4
+#define EXPORT_TIMESTAMP_COLUMN 13
+
+
+/*
+** Growable output buffer of one thread
+*/
+typedef struct
+{
+    char * data;
+    size_t length;
+    size_t capacity;
+    bool failed;
+}ExportBuffer;
+
+
+/*
+** Part of mapped file processed by one thread
+*/
+typedef struct
+{
+    const ExportQuery * query;
+    const char * begin;
+    const char * end;
+    ExportBuffer output;
+    uint64_t rows;
+    uint64_t matched;
+}ExportTask;
+
+
+/*
+** Boundaries of columns of one line
+*/
+typedef struct
+{
+    const char * starts[CSV_COLUMNS];
+    const char * end;
+    size_t count;
+}ExportLine;
+
+
+int
+export_column(const char * name)
+{
+    for(int i = 0; i < CSV_COLUMNS; i++)
+    {
+        if(strcmp(csv_header[i][0], name) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+
+void
+export_query_init(
+    ExportQuery * query
+    , const CsvMaker * csv_maker)
+{
+    *query = (ExportQuery)
+        {.csv_maker = *csv_maker
+        , .first_day = time(NULL)
+        , .last_day = time(NULL)
+        , .threads = 1};
+}
+
+
+bool
+export_add_filter(
+    ExportQuery * query
+    , const char * column
+    , const char * value)
+{
+    int index = export_column(column);
+
+    if(index < 0
+        || query->filter_count == EXPORT_MAX_FILTERS
+        || strlen(value) >= EXPORT_FILTER_SIZE)
+        return false;
+
+    ExportFilter * filter = &query->filters[query->filter_count++];
+    filter->column = (size_t) index;
+    strcpy(filter->value, value);
+
+    return true;
+}
+
+
+bool
+export_set_columns(
+    ExportQuery * query
+    , const char * columns)
+{
+    char name[128];
+
+    query->column_count = 0;
+
+    while(*columns != '\0')
+    {
+        size_t length = strcspn(columns, ",");
+
+        if(length >= sizeof(name) || query->column_count == CSV_COLUMNS)
+            return false;
+
+        memcpy(name, columns, length);
+        name[length] = '\0';
+
+        int index = export_column(name);
+
+        if(index < 0)
+            return false;
+
+        query->columns[query->column_count++] = (size_t) index;
+        columns += length;
+
+        if(*columns == ',')
+            columns++;
+    }
+
+    return query->column_count > 0;
+}
+
+
+/********************* delimiter scanner ***************/
+
+/*
+** Recording of separator found at given position
+*/
+static inline void
+line_separator(
+    ExportLine * line
+    , const char * position)
+{
+    if(line->count < CSV_COLUMNS)
+        line->starts[line->count] = position + 1;
+
+    line->count++;
+}
+
+
+/*
+** Scanning of one line for separators and its end. Sixteen bytes are
+** compared at once when SSE2 is available. Returns start of next line.
+*/
+static const char *
+scan_line(
+    const char * p
+    , const char * end
+    , char separator
+    , ExportLine * line)
+{
+    line->starts[0] = p;
+    line->count = 1;
+
+#ifdef __SSE2__
+    const __m128i separators = _mm_set1_epi8(separator);
+    const __m128i newlines = _mm_set1_epi8('\n');
+
+    for(; end - p >= 16; p += 16)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i *) p);
+        unsigned mask =
+            (unsigned) _mm_movemask_epi8(
+                _mm_or_si128(
+                    _mm_cmpeq_epi8(block, separators)
+                    , _mm_cmpeq_epi8(block, newlines)));
+
+        for(; mask != 0; mask &= mask - 1)
+        {
+            const char * hit = p + __builtin_ctz(mask);
+
+            if(*hit == '\n')
+            {
+                line->end = hit;
+                return hit + 1;
+            }
+
+            line_separator(line, hit);
+        }
+    }
+#endif
+
+    for(; p < end; p++)
+    {
+        if(*p == '\n')
+        {
+            line->end = p;
+            return p + 1;
+        }
+
+        if(*p == separator)
+            line_separator(line, p);
+    }
+
+    line->end = end;
+
+    return end;
+}
+
+
+static const char *
+column_end(
+    const ExportLine * line
+    , size_t index)
+{
+    return index + 1 < line->count ? line->starts[index + 1] - 1 : line->end;
+}
+
+
+static size_t
+column_length(
+    const ExportLine * line
+    , size_t index)
+{
+    return (size_t) (column_end(line, index) - line->starts[index]);
+}
+
+
+/*
+** Comparison of column with zero terminated string in the same way as
+** strcmp()
+*/
+static int
+column_compare(
+    const ExportLine * line
+    , size_t index
+    , const char * value)
+{
+    size_t length = column_length(line, index);
+    size_t value_length = strlen(value);
+    int result =
+        memcmp(
+            line->starts[index]
+            , value
+            , length < value_length ? length : value_length);
+
+    if(result != 0)
+        return result;
+
+    return (length > value_length) - (length < value_length);
+}
+
+
+/*
+** Check if line is data line matching all filters of query
+*/
+static bool
+line_matches(
+    const ExportQuery * query
+    , const ExportLine * line)
+{
+    if(line->count != CSV_COLUMNS)
+        return false;
+
+    size_t id_length = column_length(line, EXPORT_ID_COLUMN);
+    const char * id = line->starts[EXPORT_ID_COLUMN];
+
+    if(id_length == 0 || id[0] < '0' || id[0] > '9')
+        return false;
+
+    for(size_t i = 0; i < query->filter_count; i++)
+    {
+        if(column_compare(
+            line
+            , query->filters[i].column
+            , query->filters[i].value) != 0)
+            return false;
+    }
+
+    if(query->from[0] != '\0'
+        && column_compare(line, EXPORT_TIMESTAMP_COLUMN, query->from) < 0)
+        return false;
+
+    if(query->to[0] != '\0'
+        && column_compare(line, EXPORT_TIMESTAMP_COLUMN, query->to) > 0)
+        return false;
+
+    return true;
+}
+
+
+/********************* output ***************/
+
+static void
+buffer_append(
+    ExportBuffer * buffer
+    , const char * data
+    , size_t length)
+{
+    if(buffer->failed == true)
+        return;
+
+    if(buffer->length + length > buffer->capacity)
+    {
+        size_t capacity = buffer->capacity > 0 ? buffer->capacity : 65536;
+
+        while(capacity < buffer->length + length)
+            capacity *= 2;
+
+        char * grown = realloc(buffer->data, capacity);
+
+        if(grown == NULL)
+        {
+            buffer->failed = true;
+            return;
+        }
+
+        buffer->data = grown;
+        buffer->capacity = capacity;
+    }
+
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+}
+
+
+static void
+project_line(
+    const ExportQuery * query
+    , const ExportLine * line
+    , ExportBuffer * output)
+{
+    if(query->column_count == 0)
+    {
+        buffer_append(
+            output
+            , line->starts[0]
+            , (size_t) (line->end - line->starts[0]));
+    }
+    else
+    {
+        for(size_t i = 0; i < query->column_count; i++)
+        {
+            size_t column = query->columns[i];
+
+            if(i > 0)
+                buffer_append(output, &query->csv_maker.separator, 1);
+
+            buffer_append(
+                output
+                , line->starts[column]
+                , column_length(line, column));
+        }
+    }
+
+    buffer_append(output, "\n", 1);
+}
+
+
+static void *
+export_task(void * argument)
+{
+    ExportTask * task = argument;
+    char separator = task->query->csv_maker.separator;
+    ExportLine line;
+
+    for(const char * p = task->begin; p < task->end; )
+    {
+        p = scan_line(p, task->end, separator, &line);
+
+        if(line.end == line.starts[0])
+            continue;
+
+        task->rows++;
+
+        if(line_matches(task->query, &line) == true)
+        {
+            task->matched++;
+            project_line(task->query, &line, &task->output);
+        }
+    }
+
+    return NULL;
+}
+
+
+/*
+** Processing of mapped file in rounds, in every round each thread gets one
+** chunk which ends on line boundary and outputs are written in order
+*/
+static bool
+export_data(
+    const ExportQuery * query
+    , const char * data
+    , size_t size
+    , FILE * output
+    , ExportStats * stats)
+{
+    unsigned threads = query->threads;
+    ExportTask tasks[EXPORT_MAX_THREADS];
+    pthread_t handles[EXPORT_MAX_THREADS];
+    bool started[EXPORT_MAX_THREADS];
+    const char * end = data + size;
+    const char * p = data;
+    bool result = true;
+
+    if(threads < 1)
+        threads = 1;
+
+    if(threads > EXPORT_MAX_THREADS)
+        threads = EXPORT_MAX_THREADS;
+
+    memset(tasks, 0, sizeof(tasks));
+
+    while(p < end && result == true)
+    {
+        unsigned count = 0;
+
+        for(; count < threads && p < end; count++)
+        {
+            const char * chunk_end =
+                (size_t) (end - p) > EXPORT_CHUNK_SIZE
+                    ? p + EXPORT_CHUNK_SIZE
+                    : end;
+
+            if(chunk_end < end)
+            {
+                const char * newline =
+                    memchr(chunk_end, '\n', (size_t) (end - chunk_end));
+                chunk_end = newline != NULL ? newline + 1 : end;
+            }
+
+            tasks[count].query = query;
+            tasks[count].begin = p;
+            tasks[count].end = chunk_end;
+            tasks[count].output.length = 0;
+            tasks[count].rows = 0;
+            tasks[count].matched = 0;
+            p = chunk_end;
+        }
+
+        for(unsigned i = 1; i < count; i++)
+            started[i] =
+                pthread_create(&handles[i], NULL, export_task, &tasks[i]) == 0;
+
+        export_task(&tasks[0]);
+
+        for(unsigned i = 1; i < count; i++)
+        {
+            if(started[i] == true)
+                pthread_join(handles[i], NULL);
+            else
+                export_task(&tasks[i]);
+        }
+
+        for(unsigned i = 0; i < count; i++)
+        {
+            ExportBuffer * buffer = &tasks[i].output;
+
+            stats->rows += tasks[i].rows;
+            stats->matched += tasks[i].matched;
+
+            if(buffer->failed == true
+                || fwrite(buffer->data, 1, buffer->length, output)
+                    != buffer->length)
+                result = false;
+        }
+    }
+
+    for(unsigned i = 0; i < threads; i++)
+        free(tasks[i].output.data);
+
+    return result;
+}
+
+
+static bool
+export_file(
+    const ExportQuery * query
+    , const char * path
+    , FILE * output
+    , ExportStats * stats)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    if(fd < 0)
+        return errno == ENOENT;
+
+    struct stat st;
+
+    if(fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    if(st.st_size == 0)
+    {
+        close(fd);
+        return true;
+    }
+
+    size_t size = (size_t) st.st_size;
+    char * data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(data == MAP_FAILED)
+        return false;
+
+    posix_madvise(data, size, POSIX_MADV_SEQUENTIAL);
+
+    bool result = export_data(query, data, size, output, stats);
+
+    stats->files++;
+    stats->bytes += size;
+    munmap(data, size);
+
+    return result;
+}
+
+
+static int
+day_key(const struct tm * tm)
+{
+    return (tm->tm_year + 1900) * 10000 + (tm->tm_mon + 1) * 100 + tm->tm_mday;
+}
+
+
+bool
+export_run(
+    const ExportQuery * query
+    , FILE * output
+    , ExportStats * stats)
+{
+    *stats = (ExportStats) {0};
+
+    for(size_t i = 0
+        ; i < (query->column_count > 0 ? query->column_count : CSV_COLUMNS)
+        ; i++)
+    {
+        size_t column = query->column_count > 0 ? query->columns[i] : i;
+
+        if(i > 0)
+            fputc(query->csv_maker.separator, output);
+
+        fputs(csv_header[column][0], output);
+    }
+
+    fprintf(output, "\n");
+
+    struct tm day;
+    struct tm last;
+    localtime_r(&query->first_day, &day);
+    localtime_r(&query->last_day, &last);
+
+    day.tm_hour = 12;
+    day.tm_min = 0;
+    day.tm_sec = 0;
+    day.tm_isdst = -1;
+
+    bool result = true;
+
+    while(result == true && day_key(&day) <= day_key(&last))
+    {
+        char path[CSV_PATH_SIZE];
+        time_t t = mktime(&day);
+
+        generate_csv_name(&query->csv_maker, t, path, sizeof(path));
+        result = export_file(query, path, output, stats);
+
+        day.tm_mday++;
+        day.tm_isdst = -1;
+        mktime(&day);
+    }
+
+    return result && fflush(output) == 0;
+}
@@ -0,0 +1,109 @@
+#ifndef _EXPORT_H_
+#define _EXPORT_H_
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "csv.h"
+
+
+#define EXPORT_MAX_FILTERS 8
+#define EXPORT_FILTER_SIZE 64
+
+/*
+** Size of part of csv file processed by one thread in one round. Memory
+** used by export is bounded by number of threads times chunk size.
+*/
+#define EXPORT_CHUNK_SIZE (8 * 1024 * 1024)
+#define EXPORT_MAX_THREADS 64
+
+
+/*
+** Filter of rows by exact value of column
+*/
+typedef struct
+{
+    size_t column;
+    char value[EXPORT_FILTER_SIZE];
+}ExportFilter;
+
+
+/*
+** Query over daily csv files. Files from first_day to last_day are read,
+** rows are filtered by column values and by time window over the end of
+** glue application (empty from/to means unlimited) and projected into
+** given columns (all columns when column_count is 0).
+*/
+typedef struct
+{
+    CsvMaker csv_maker;
+    time_t first_day;
+    time_t last_day;
+    char from[24];
+    char to[24];
+    ExportFilter filters[EXPORT_MAX_FILTERS];
+    size_t filter_count;
+    size_t columns[CSV_COLUMNS];
+    size_t column_count;
+    unsigned threads;
+}ExportQuery;
+
+
+/*
+** Statistics of finished export
+*/
+typedef struct
+{
+    unsigned files;
+    uint64_t bytes;
+    uint64_t rows;
+    uint64_t matched;
+}ExportStats;
+
+
+/*
+** Index of column with given name in csv header or -1
+*/
+int
+export_column(const char * name);
+
+
+void
+export_query_init(
+    ExportQuery * query
+    , const CsvMaker * csv_maker);
+
+
+/*
+** Adding of filter, returns false for unknown column or too many filters
+*/
+bool
+export_add_filter(
+    ExportQuery * query
+    , const char * column
+    , const char * value);
+
+
+/*
+** Setting of projection from comma separated list of column names
+*/
+bool
+export_set_columns(
+    ExportQuery * query
+    , const char * columns);
+
+
+/*
+** Running of query. Matching rows of all files are written into output in
+** order of files and rows, preceded by one header line.
+*/
+bool
+export_run(
+    const ExportQuery * query
+    , FILE * output
+    , ExportStats * stats);
+
+
+#endif
@@ -0,0 +1,232 @@
+#include <string.h>
+#include <time.h>
+
+#include "glass.h"
+#include "glass_view.h"
+
+
+uint16_t
+swap_endian_int16(uint16_t n)
+{
+    return ((n>>8) | (n<<8));
+}
+
+
+uint32_t
+swap_endian_int32(uint32_t n)
+{
+    return (((n) >> 24)
+     | (((n) & 0x00FF0000) >> 8)
+     | (((n) & 0x0000FF00) << 8)
+     | ((n) << 24));
+}
+
+
+float
+swap_endian_float(float n)
+{
+    uint32_t bits;
+
+    memcpy(&bits, &n, sizeof(bits));
+    bits = swap_endian_int32(bits);
+    memcpy(&n, &bits, sizeof(n));
+
+    return n;
+}
+
+
+/*
+** Copy of fixed size string from PLC byte array with zero termination
+*/
+static void
+load_string(
+    char * destination
+    , const char * address
+    , size_t size)
+{
+    memcpy(destination, address, size);
+    destination[size] = '\0';
+}
+
+
+const char *
+vehicle_model_to_string(GlassModel model)
+{
+  switch(model)
+  {
+    case T7:
+      return "T7";
+    case ID_BUZZ:
+      return "ID.BUZZ";
+    default:
+      return "NaN";
+  }
+}
+
+
+uint64_t
+dtl_to_seconds(DTL dtl)
+{
+  return ((uint64_t)(((((dtl.YEAR > 0) ? dtl.YEAR-1970 : 0))*31556925.216)
+  + (dtl.MONTH*30.4368499*86400)
+  + (dtl.DAY*86400)
+  + (dtl.HOUR*3600)
+  + (dtl.MINUTE*60)
+  + dtl.SECOND));
+}
+
+
+int64_t
+dtl_to_unix_us(DTL dtl)
+{
+  if(dtl.YEAR == 0 || dtl.MONTH == 0 || dtl.DAY == 0)
+    return -1;
+
+  struct tm tm =
+    {.tm_year = dtl.YEAR - 1900
+    , .tm_mon = dtl.MONTH - 1
+    , .tm_mday = dtl.DAY
+    , .tm_hour = dtl.HOUR
+    , .tm_min = dtl.MINUTE
+    , .tm_sec = dtl.SECOND
+    , .tm_isdst = -1};
+  time_t t = mktime(&tm);
+
+  if(t == (time_t) -1)
+    return -1;
+
+  return (int64_t) t * 1000000 + dtl.NANOSECOND / 1000;
+}
+
+
+int64_t
+dtl_to_civil_us(DTL dtl)
+{
+  if(dtl.YEAR == 0
+    || dtl.MONTH == 0
+    || dtl.MONTH > 12
+    || dtl.DAY == 0
+    || dtl.DAY > 31)
+    return -1;
+
+  // days from civil date, March is the first month of shifted year
+  int64_t year = dtl.YEAR - (dtl.MONTH <= 2);
+  int64_t era = year / 400;
+  int64_t year_of_era = year - era * 400;
+  int64_t month = dtl.MONTH > 2 ? dtl.MONTH - 3 : dtl.MONTH + 9;
+  int64_t day_of_year = (153 * month + 2) / 5 + dtl.DAY - 1;
+  int64_t day_of_era =
+    year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+  int64_t days = era * 146097 + day_of_era - 719468;
+
+  return ((days * 86400
+      + dtl.HOUR * 3600
+      + dtl.MINUTE * 60
+      + dtl.SECOND) * 1000000
+    + dtl.NANOSECOND / 1000);
+}
+
+
+DTL
+read_dtl(
+    size_t base
+    , const char byte_array[])
+{
+    return glass_view_dtl((GlassView) {byte_array}, base);
+}
+
+
+BarrelInfo
+read_barrel_info(
+    size_t base
+    , const char byte_array[])
+{
+    GlassView view = {byte_array};
+    BarrelInfo barrel;
+
+    load_string(
+        barrel.batchNumber
+        , glass_view_barrel_batch_number(view, base)
+        , GLASS_BARREL_NUMBER_SIZE);
+    load_string(
+        barrel.serialNumber
+        , glass_view_barrel_serial_number(view, base)
+        , GLASS_BARREL_NUMBER_SIZE);
+    barrel.expiration_year = glass_view_barrel_expiration_year(view, base);
+    barrel.expiration_month = glass_view_barrel_expiration_month(view, base);
+    barrel.expiration = glass_view_barrel_expiration(view, base);
+
+    return barrel;
+}
+
+
+Glass *
+read_glass_structure(
+    size_t size
+    , const char byte_array[size]
+    , Glass * glass)
+{
+    GlassView view;
+
+    if(glass_view_init(&view, size, byte_array) == false)
+        return NULL;
+
+    load_string(glass->jobNr, glass_view_job_nr(view), GLASS_JOB_NR_SIZE);
+    load_string(
+        glass->vehicleNumber
+        , glass_view_vehicle_number(view)
+        , GLASS_VEHICLE_NUMBER_SIZE);
+    load_string(
+        glass->rearWindow
+        , glass_view_rear_window(view)
+        , GLASS_REAR_WINDOW_SIZE);
+    glass->vehicleModel = glass_view_vehicle_model(view);
+    glass->id = glass_view_id(view);
+    glass->drawerIndex = glass_view_drawer_index(view);
+
+    for(size_t i = 0; i < 12; i++)
+        glass->metralightZone[i] = glass_view_metralight_zone(view, i);
+
+    glass->primerApplicationTime =
+        glass_view_dtl(view, GLASS_OFFSET_PRIMER_APPLICATION_TIME);
+    glass->primerFlashoffTime =
+        glass_view_dtl(view, GLASS_OFFSET_PRIMER_FLASHOFF_TIME);
+    glass->timeSinceLastDispense =
+        glass_view_dtl(view, GLASS_OFFSET_LAST_DISPENSE_TIME);
+    glass->glueStartApplicationTime =
+        glass_view_dtl(view, GLASS_OFFSET_GLUE_START_TIME);
+    glass->glueEndApplicationTime =
+        glass_view_dtl(view, GLASS_OFFSET_GLUE_END_TIME);
+    glass->assemblyTime = glass_view_dtl(view, GLASS_OFFSET_ASSEMBLY_TIME);
+    glass->A = read_barrel_info(GLASS_OFFSET_BARREL_A, byte_array);
+    glass->B = read_barrel_info(GLASS_OFFSET_BARREL_B, byte_array);
+    glass->aAppliedGlueAmount = glass_view_a_applied_glue_amount(view);
+    glass->bAppliedGlueAmount = glass_view_b_applied_glue_amount(view);
+    glass->pistolTemperatureMin = glass_view_pistol_temperature_min(view);
+    glass->pistolTempDuringApp = glass_view_pistol_temp_during_app(view);
+    glass->pistolTemperatureMax = glass_view_pistol_temperature_max(view);
+    glass->aPotTemperatureMin = glass_view_a_pot_temperature_min(view);
+    glass->aPotTempDuringApp = glass_view_a_pot_temp_during_app(view);
+    glass->aPotTemperatureMax = glass_view_a_pot_temperature_max(view);
+    glass->aApplicationRatio = glass_view_a_application_ratio(view);
+    glass->bApplicationRatio = glass_view_b_application_ratio(view);
+    glass->mixerTubeLife = glass_view_mixer_tube_life(view);
+    glass->ambientHumidity = glass_view_ambient_humidity(view);
+    glass->ambientTemperature = glass_view_ambient_temperature(view);
+    glass->primerAppEnable = glass_view_primer_app_enable(view);
+    glass->primerInspectionEnable = glass_view_primer_inspection_enable(view);
+    glass->primerInspectionResult = glass_view_primer_inspection_result(view);
+    glass->metralightEn = glass_view_metralight_en(view);
+    glass->glueApplicationResult = glass_view_glue_application_result(view);
+    glass->glueInspectionBypass = glass_view_glue_inspection_bypass(view);
+    glass->robotCompleteSuccess = glass_view_robot_complete_success(view);
+    glass->dispenseCompleteSuccess =
+        glass_view_dispense_complete_success(view);
+    glass->rotaryUniteCompleteSucces =
+        glass_view_rotary_unite_complete_success(view);
+    glass->addhesiveProcessComplete =
+        glass_view_addhesive_process_complete(view);
+    glass->zones = glass_view_zones(view);
+
+    return glass;
+}
@@ -0,0 +1,228 @@
+#ifndef _GLASS_H_
+#define _GLASS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/*
+** Size of the Glass structure in PLC datablock
+*/
+#define DB_GLASS_STRUCT_SIZE 288
+
+
+/********************* data types definitions *****************/
+
+/*
+** Enum with glass models
+*/
+typedef enum
+{
+   T7 = 7
+   , ID_BUZZ = 1
+}GlassModel;
+
+
+/*
+** DTL structure for recording date and time
+*/
+typedef struct
+{
+    uint16_t YEAR;
+    uint8_t MONTH;
+    uint8_t DAY;
+    uint8_t WEEKDAY;
+    uint8_t HOUR;
+    uint8_t MINUTE;
+    uint8_t SECOND;
+    uint32_t NANOSECOND;
+}DTL;
+
+
+/*
+** Structure for holding results states from primer control of the glass
+*/
+typedef struct
+{
+    uint8_t zone1:1;
+    uint8_t zone2:1;
+    uint8_t zone3:1;
+    uint8_t zone4:1;
+}PrimerDetectionZones;
+
+
+/*
+** Enum with Metralight inspection results state
+*/
+typedef enum
+{
+    MetralightOK = 0x10
+    , MetralightNOK = 0x20
+    , MetralightError = 255
+}MetralightStatus;
+
+
+/*
+** Structure with validation information of barrel
+*/
+typedef struct
+{
+    char batchNumber[17];
+    char serialNumber[17];
+    uint16_t expiration_year;
+    uint8_t expiration_month;
+    uint8_t expiration : 1;
+}BarrelInfo;
+
+
+/*
+** Structure with information from glass production
+*/
+typedef struct
+{
+    char jobNr[11];
+    char vehicleNumber[14];
+    char rearWindow[19];
+    uint8_t vehicleModel;
+    uint32_t id;
+    uint8_t primerAppEnable : 1;
+    uint8_t primerInspectionEnable : 1;
+    uint8_t primerInspectionResult : 1;
+    uint8_t  metralightEn : 1;
+    uint8_t glueApplicationResult : 1;
+    uint8_t glueInspectionBypass : 1;
+    uint8_t robotCompleteSuccess :1;
+    uint8_t dispenseCompleteSuccess   : 1;
+    uint8_t rotaryUniteCompleteSucces : 1;
+    uint8_t addhesiveProcessComplete  : 1;
+    PrimerDetectionZones zones;
+    uint16_t drawerIndex;
+    DTL primerApplicationTime;
+    DTL primerFlashoffTime;
+    DTL timeSinceLastDispense;
+    DTL glueStartApplicationTime;
+    DTL glueEndApplicationTime;
+    DTL assemblyTime;
+    MetralightStatus metralightZone[12];
+    BarrelInfo A;
+    BarrelInfo B;
+    float aAppliedGlueAmount;
+    int pistolTemperatureMin;
+    float pistolTempDuringApp;
+    int pistolTemperatureMax;
+    int aPotTemperatureMin;
+    float aPotTempDuringApp;
+    int aPotTemperatureMax;
+    float bAppliedGlueAmount;
+    float aApplicationRatio;
+    float bApplicationRatio;
+    int32_t mixerTubeLife;
+    float ambientHumidity;
+    float ambientTemperature;
+}Glass;
+
+
+/********************* glass decoding functions ***************/
+
+/*
+** function for swaping bytes of 16-bits variable
+*/
+uint16_t
+swap_endian_int16(uint16_t n);
+
+
+/*
+** function for swaping bytes of 32-bits variables
+*/
+uint32_t
+swap_endian_int32(uint32_t n);
+
+
+/*
+** function for swaping bytes of 32-bits float variable
+*/
+float
+swap_endian_float(float n);
+
+
+/*
+** generic macro for swaping bytes of 16-bits or 32-bits
+** variable
+*/
+#define swap_endian(n)                 \
+    _Generic(                          \
+        (n)                            \
+        , int16_t: swap_endian_int16   \
+        , uint16_t: swap_endian_int16  \
+        , int32_t: swap_endian_int32   \
+        , uint32_t: swap_endian_int32  \
+        , float: swap_endian_float)    \
+            (n)
+
+
+/*
+** Conversion of constatn defining vehicle model into
+** string representation
+*/
+const char *
+vehicle_model_to_string(GlassModel model);
+
+
+/*
+** Conversion DTL structure (structured time format) into seconds
+*/
+uint64_t
+dtl_to_seconds(DTL dtl);
+
+
+/*
+** Conversion DTL structure in local time of PLC into microseconds since
+** the Unix epoch. Returns -1 for unset or invalid DTL.
+*/
+int64_t
+dtl_to_unix_us(DTL dtl);
+
+
+/*
+** Conversion DTL structure into microseconds since 1970-01-01 00:00 of
+** the same calendar, the time zone is not looked up. It is meant for
+** differences of two DTLs and never blocks. Returns -1 for unset or
+** invalid DTL.
+*/
+int64_t
+dtl_to_civil_us(DTL dtl);
+
+
+/*
+** Function for reading DTL structure from given byte_array and
+** given memory address
+*/
+DTL
+read_dtl(
+    size_t base
+    , const char byte_array[]);
+
+
+/*
+** Function for reading BarrelInfo structure from given byte_array and
+** given memory address
+*/
+BarrelInfo
+read_barrel_info(
+    size_t base
+    , const char byte_array[]);
+
+
+/*
+** Function for parsing Glass structure from byte array into Glass structure
+** owned by caller. Returns NULL when byte array is shorter than
+** DB_GLASS_STRUCT_SIZE
+*/
+Glass *
+read_glass_structure(
+    size_t size
+    , const char byte_array[size]
+    , Glass * glass);
+
+
+#endif
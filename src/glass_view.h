@@ -0,0 +1,434 @@
+#ifndef _GLASS_VIEW_H_
+#define _GLASS_VIEW_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "glass.h"
+
+
+/*
+** Offsets of fields of Glass structure in PLC datablock
+*/
+#define GLASS_OFFSET_JOB_NR 2
+#define GLASS_OFFSET_VEHICLE_NUMBER 28
+#define GLASS_OFFSET_REAR_WINDOW 44
+#define GLASS_OFFSET_VEHICLE_MODEL 62
+#define GLASS_OFFSET_ID 64
+#define GLASS_OFFSET_PRIMER_APPLICATION_TIME 74
+#define GLASS_OFFSET_PRIMER_FLASHOFF_TIME 86
+#define GLASS_OFFSET_GLUE_START_TIME 98
+#define GLASS_OFFSET_GLUE_END_TIME 110
+#define GLASS_OFFSET_ASSEMBLY_TIME 122
+#define GLASS_OFFSET_LAST_DISPENSE_TIME 134
+#define GLASS_OFFSET_ZONES 146
+#define GLASS_OFFSET_DRAWER_INDEX 148
+#define GLASS_OFFSET_PISTOL_TEMP_MAX 150
+#define GLASS_OFFSET_PISTOL_TEMP_MIN 152
+#define GLASS_OFFSET_POT_TEMP_MAX 154
+#define GLASS_OFFSET_POT_TEMP_MIN 156
+#define GLASS_OFFSET_MIXER_TUBE_LIFE 158
+#define GLASS_OFFSET_RESULTS 162
+#define GLASS_OFFSET_ENABLES 163
+#define GLASS_OFFSET_A_RATIO 164
+#define GLASS_OFFSET_B_RATIO 168
+#define GLASS_OFFSET_PISTOL_TEMP 172
+#define GLASS_OFFSET_POT_TEMP 176
+#define GLASS_OFFSET_A_AMOUNT 180
+#define GLASS_OFFSET_B_AMOUNT 184
+#define GLASS_OFFSET_HUMIDITY 188
+#define GLASS_OFFSET_AMBIENT_TEMP 192
+#define GLASS_OFFSET_METRALIGHT 196
+#define GLASS_OFFSET_BARREL_A 208
+#define GLASS_OFFSET_BARREL_B 248
+
+#define GLASS_JOB_NR_SIZE 10
+#define GLASS_VEHICLE_NUMBER_SIZE 13
+#define GLASS_REAR_WINDOW_SIZE 18
+#define GLASS_BARREL_NUMBER_SIZE 16
+
+
+/*
+** Read only view of Glass structure in raw PLC datablock.
+**
+** View does not copy the record, every accessor decodes only its field
+** directly from the buffer, so consumers needing few fields (rules, ids)
+** skip decoding of the whole Glass structure. Buffer must outlive the
+** view and have at least DB_GLASS_STRUCT_SIZE bytes.
+*/
+typedef struct
+{
+    const char * data;
+}GlassView;
+
+
+/*
+** Unaligned big-endian loads from PLC byte array
+*/
+static inline uint16_t
+glass_load_uint16(const char * address)
+{
+    uint16_t n;
+    memcpy(&n, address, sizeof(n));
+    return swap_endian(n);
+}
+
+
+static inline int16_t
+glass_load_int16(const char * address)
+{
+    return (int16_t) glass_load_uint16(address);
+}
+
+
+static inline uint32_t
+glass_load_uint32(const char * address)
+{
+    uint32_t n;
+    memcpy(&n, address, sizeof(n));
+    return swap_endian(n);
+}
+
+
+static inline float
+glass_load_float(const char * address)
+{
+    float n;
+    memcpy(&n, address, sizeof(n));
+    return swap_endian(n);
+}
+
+
+static inline bool
+glass_load_bit(
+    const char * address
+    , unsigned bit)
+{
+    return (*address >> bit) & 1;
+}
+
+
+/*
+** Creation of view over byte array. Returns false when byte array is
+** shorter than DB_GLASS_STRUCT_SIZE.
+*/
+static inline bool
+glass_view_init(
+    GlassView * view
+    , size_t size
+    , const char byte_array[size])
+{
+    view->data = byte_array;
+
+    return size >= DB_GLASS_STRUCT_SIZE;
+}
+
+
+static inline uint32_t
+glass_view_id(GlassView view)
+{
+    return glass_load_uint32(view.data + GLASS_OFFSET_ID);
+}
+
+
+static inline uint8_t
+glass_view_vehicle_model(GlassView view)
+{
+    return (uint8_t) view.data[GLASS_OFFSET_VEHICLE_MODEL];
+}
+
+
+/*
+** Strings are not zero terminated in datablock, they have fixed sizes
+** GLASS_*_SIZE
+*/
+static inline const char *
+glass_view_job_nr(GlassView view)
+{
+    return view.data + GLASS_OFFSET_JOB_NR;
+}
+
+
+static inline const char *
+glass_view_vehicle_number(GlassView view)
+{
+    return view.data + GLASS_OFFSET_VEHICLE_NUMBER;
+}
+
+
+static inline const char *
+glass_view_rear_window(GlassView view)
+{
+    return view.data + GLASS_OFFSET_REAR_WINDOW;
+}
+
+
+static inline uint16_t
+glass_view_drawer_index(GlassView view)
+{
+    return glass_load_uint16(view.data + GLASS_OFFSET_DRAWER_INDEX);
+}
+
+
+/*
+** DTL at given GLASS_OFFSET_*_TIME
+*/
+static inline DTL
+glass_view_dtl(
+    GlassView view
+    , size_t offset)
+{
+    const char * p = view.data + offset;
+
+    return (DTL)
+        {.YEAR = glass_load_uint16(p)
+        , .MONTH = (uint8_t) p[2]
+        , .DAY = (uint8_t) p[3]
+        , .WEEKDAY = (uint8_t) p[4]
+        , .HOUR = (uint8_t) p[5]
+        , .MINUTE = (uint8_t) p[6]
+        , .SECOND = (uint8_t) p[7]
+        , .NANOSECOND = glass_load_uint32(p + 8)};
+}
+
+
+static inline MetralightStatus
+glass_view_metralight_zone(
+    GlassView view
+    , size_t zone)
+{
+    return (MetralightStatus)
+        (uint8_t) view.data[GLASS_OFFSET_METRALIGHT + zone];
+}
+
+
+static inline PrimerDetectionZones
+glass_view_zones(GlassView view)
+{
+    const char * p = view.data + GLASS_OFFSET_ZONES;
+
+    return (PrimerDetectionZones)
+        {.zone1 = glass_load_bit(p, 0)
+        , .zone2 = glass_load_bit(p, 1)
+        , .zone3 = glass_load_bit(p, 2)
+        , .zone4 = glass_load_bit(p, 3)};
+}
+
+
+static inline int
+glass_view_pistol_temperature_min(GlassView view)
+{
+    return glass_load_int16(view.data + GLASS_OFFSET_PISTOL_TEMP_MIN);
+}
+
+
+static inline int
+glass_view_pistol_temperature_max(GlassView view)
+{
+    return glass_load_int16(view.data + GLASS_OFFSET_PISTOL_TEMP_MAX);
+}
+
+
+static inline float
+glass_view_pistol_temp_during_app(GlassView view)
+{
+    return glass_load_float(view.data + GLASS_OFFSET_PISTOL_TEMP);
+}
+
+
+static inline int
+glass_view_a_pot_temperature_min(GlassView view)
+{
+    return glass_load_int16(view.data + GLASS_OFFSET_POT_TEMP_MIN);
+}
+
+
+static inline int
+glass_view_a_pot_temperature_max(GlassView view)
+{
+    return glass_load_int16(view.data + GLASS_OFFSET_POT_TEMP_MAX);
+}
+
+
+static inline float
+glass_view_a_pot_temp_during_app(GlassView view)
+{
+    return glass_load_float(view.data + GLASS_OFFSET_POT_TEMP);
+}
+
+
+static inline int32_t
+glass_view_mixer_tube_life(GlassView view)
+{
+    return (int32_t)
+        glass_load_uint32(view.data + GLASS_OFFSET_MIXER_TUBE_LIFE);
+}
+
+
+static inline float
+glass_view_a_application_ratio(GlassView view)
+{
+    return glass_load_float(view.data + GLASS_OFFSET_A_RATIO);
+}
+
+
+static inline float
+glass_view_b_application_ratio(GlassView view)
+{
+    return glass_load_float(view.data + GLASS_OFFSET_B_RATIO);
+}
+
+
+static inline float
+glass_view_a_applied_glue_amount(GlassView view)
+{
+    return glass_load_float(view.data + GLASS_OFFSET_A_AMOUNT);
+}
+
+
+static inline float
+glass_view_b_applied_glue_amount(GlassView view)
+{
+    return glass_load_float(view.data + GLASS_OFFSET_B_AMOUNT);
+}
+
+
+static inline float
+glass_view_ambient_humidity(GlassView view)
+{
+    return glass_load_float(view.data + GLASS_OFFSET_HUMIDITY);
+}
+
+
+static inline float
+glass_view_ambient_temperature(GlassView view)
+{
+    return glass_load_float(view.data + GLASS_OFFSET_AMBIENT_TEMP);
+}
+
+
+/*
+** Result and enable bits
+*/
+static inline bool
+glass_view_primer_inspection_result(GlassView view)
+{
+    return glass_load_bit(view.data + GLASS_OFFSET_RESULTS, 1);
+}
+
+
+static inline bool
+glass_view_glue_application_result(GlassView view)
+{
+    return glass_load_bit(view.data + GLASS_OFFSET_RESULTS, 2);
+}
+
+
+static inline bool
+glass_view_metralight_en(GlassView view)
+{
+    return glass_load_bit(view.data + GLASS_OFFSET_RESULTS, 3);
+}
+
+
+static inline bool
+glass_view_dispense_complete_success(GlassView view)
+{
+    return glass_load_bit(view.data + GLASS_OFFSET_RESULTS, 4);
+}
+
+
+static inline bool
+glass_view_robot_complete_success(GlassView view)
+{
+    return glass_load_bit(view.data + GLASS_OFFSET_RESULTS, 5);
+}
+
+
+static inline bool
+glass_view_rotary_unite_complete_success(GlassView view)
+{
+    return glass_load_bit(view.data + GLASS_OFFSET_RESULTS, 7);
+}
+
+
+static inline bool
+glass_view_addhesive_process_complete(GlassView view)
+{
+    return glass_load_bit(view.data + GLASS_OFFSET_ENABLES, 0);
+}
+
+
+static inline bool
+glass_view_primer_inspection_enable(GlassView view)
+{
+    return glass_load_bit(view.data + GLASS_OFFSET_ENABLES, 2);
+}
+
+
+static inline bool
+glass_view_primer_app_enable(GlassView view)
+{
+    return glass_load_bit(view.data + GLASS_OFFSET_ENABLES, 3);
+}
+
+
+static inline bool
+glass_view_glue_inspection_bypass(GlassView view)
+{
+    return glass_load_bit(view.data + GLASS_OFFSET_ENABLES, 4);
+}
+
+
+/*
+** Barrel information at GLASS_OFFSET_BARREL_A or GLASS_OFFSET_BARREL_B,
+** batch and serial numbers have GLASS_BARREL_NUMBER_SIZE
+*/
+static inline const char *
+glass_view_barrel_batch_number(
+    GlassView view
+    , size_t barrel)
+{
+    return view.data + barrel + 2;
+}
+
+
+static inline const char *
+glass_view_barrel_serial_number(
+    GlassView view
+    , size_t barrel)
+{
+    return view.data + barrel + 20;
+}
+
+
+static inline uint16_t
+glass_view_barrel_expiration_year(
+    GlassView view
+    , size_t barrel)
+{
+    return glass_load_uint16(view.data + barrel + 36);
+}
+
+
+static inline uint8_t
+glass_view_barrel_expiration_month(
+    GlassView view
+    , size_t barrel)
+{
+    return (uint8_t) view.data[barrel + 38];
+}
+
+
+static inline bool
+glass_view_barrel_expiration(
+    GlassView view
+    , size_t barrel)
+{
+    return glass_load_bit(view.data + barrel + 39, 0);
+}
+
+
+#endif
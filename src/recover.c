@@ -0,0 +1,351 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "recover.h"
+
+
+/*
+** Columns of csv file with glass id and time of the end of glue application
+*/
+#define RECOVERY_ID_COLUMN 4
+#define RECOVERY_TIMESTAMP_COLUMN 13
+
+
+/*
+** Finding of the last occurrence of character in memory
+*/
+static const char *
+find_last(
+    const char * begin
+    , const char * end
+    , char c)
+{
+    while(end > begin)
+    {
+        if(*--end == c)
+            return end;
+    }
+
+    return NULL;
+}
+
+
+/*
+** Check if line has all columns and ends with complete last column, which
+** is always true/false in data lines and fixed text in header lines
+*/
+static bool
+line_complete(
+    char separator
+    , const char * begin
+    , const char * end)
+{
+    size_t separators = 0;
+    const char * last = begin;
+
+    for(const char * p = begin; p < end; p++)
+    {
+        if(*p == separator)
+        {
+            separators++;
+            last = p + 1;
+        }
+    }
+
+    if(separators != CSV_COLUMNS - 1)
+        return false;
+
+    const char * values[] =
+    {
+        "true"
+        , "false"
+        , csv_header[CSV_COLUMNS - 1][0]
+        , csv_header[CSV_COLUMNS - 1][1]
+    };
+    size_t length = (size_t) (end - last);
+
+    for(size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+    {
+        if(strlen(values[i]) == length
+            && memcmp(values[i], last, length) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+
+/*
+** Copy of column with given index from line into buffer
+*/
+static bool
+line_column(
+    char separator
+    , const char * begin
+    , const char * end
+    , size_t index
+    , char * buffer
+    , size_t size)
+{
+    for(; index > 0 && begin < end; begin++)
+    {
+        if(*begin == separator)
+            index--;
+    }
+
+    if(index > 0)
+        return false;
+
+    const char * column_end = memchr(begin, separator, (size_t) (end - begin));
+    size_t length = (size_t) ((column_end != NULL ? column_end : end) - begin);
+
+    if(length >= size)
+        return false;
+
+    memcpy(buffer, begin, length);
+    buffer[length] = '\0';
+
+    return true;
+}
+
+
+bool
+recover_line_id(
+    char separator
+    , const char * begin
+    , const char * end
+    , uint32_t * id)
+{
+    char column[16];
+
+    if(line_column(
+        separator
+        , begin
+        , end
+        , RECOVERY_ID_COLUMN
+        , column
+        , sizeof(column)) == false
+        || column[0] == '\0'
+        || strspn(column, "0123456789") != strlen(column))
+        return false;
+
+    *id = (uint32_t) strtoul(column, NULL, 10);
+
+    return true;
+}
+
+
+/*
+** Reading of glass id and timestamp from the last complete line
+*/
+static void
+read_last_record(
+    char separator
+    , const char * begin
+    , const char * end
+    , RecoveryInfo * info)
+{
+    if(recover_line_id(separator, begin, end, &info->last_id) == false)
+        return;
+
+    info->has_record = true;
+
+    if(line_column(
+        separator
+        , begin
+        , end
+        , RECOVERY_TIMESTAMP_COLUMN
+        , info->last_timestamp
+        , sizeof(info->last_timestamp)) == false)
+        info->last_timestamp[0] = '\0';
+}
+
+
+bool
+recover_csv_tail(
+    const CsvMaker * csv_maker
+    , const char * path
+    , RecoveryInfo * info)
+{
+    *info = (RecoveryInfo) {0};
+
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+
+    if(fd < 0)
+        return errno == ENOENT;
+
+    struct stat st;
+
+    if(fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    off_t size = st.st_size;
+    info->size = size;
+
+    if(size == 0)
+    {
+        close(fd);
+        return true;
+    }
+
+    long page = sysconf(_SC_PAGESIZE);
+    off_t start = size > RECOVERY_WINDOW ? size - RECOVERY_WINDOW : 0;
+    start -= start % page;
+
+    size_t length = (size_t) (size - start);
+    char * data = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, start);
+
+    if(data == MAP_FAILED)
+    {
+        close(fd);
+        return false;
+    }
+
+    char separator = csv_maker->separator;
+    const char * end = data + length;
+    const char * line_end = NULL;
+    off_t new_size = size;
+    bool terminate = false;
+    bool result = true;
+
+    if(end[-1] == '\n')
+        line_end = end - 1;
+    else
+    {
+        const char * newline = find_last(data, end, '\n');
+        const char * tail = newline != NULL ? newline + 1 : data;
+
+        if(newline == NULL && start > 0)
+            result = false;
+        else if(line_complete(separator, tail, end) == true)
+        {
+            terminate = true;
+            line_end = end;
+        }
+        else
+        {
+            new_size = start + (tail - data);
+            line_end = newline;
+        }
+    }
+
+    // file without complete two lines of header is started again
+    if(result == true && start == 0)
+    {
+        size_t lines = terminate ? 1 : 0;
+
+        for(const char * p = data; p < data + new_size; p++)
+            lines += *p == '\n';
+
+        if(lines < 2)
+        {
+            new_size = 0;
+            terminate = false;
+            line_end = NULL;
+        }
+    }
+
+    if(result == true && line_end != NULL)
+    {
+        const char * newline = find_last(data, line_end, '\n');
+
+        read_last_record(
+            separator
+            , newline != NULL ? newline + 1 : data
+            , line_end
+            , info);
+    }
+
+    munmap(data, length);
+
+    if(result == true && new_size < size)
+    {
+        if(ftruncate(fd, new_size) == 0)
+            info->truncated = size - new_size;
+        else
+            result = false;
+    }
+
+    if(result == true && terminate == true)
+    {
+        if(pwrite(fd, "\n", 1, size) == 1)
+        {
+            info->terminated = true;
+            new_size = size + 1;
+        }
+        else
+            result = false;
+    }
+
+    info->size = new_size;
+
+    if(close(fd) != 0)
+        result = false;
+
+    return result;
+}
+
+
+/*
+** Formating of time of the end of glue application like in csv file
+*/
+static void
+glue_end_timestamp(
+    const Glass * glass
+    , char * buffer
+    , size_t size)
+{
+    DTL dtl = glass->glueEndApplicationTime;
+
+    snprintf(
+        buffer
+        , size
+        , CSV_DTL_FORMAT
+        , dtl.YEAR
+        , dtl.MONTH
+        , dtl.DAY
+        , dtl.HOUR
+        , dtl.MINUTE
+        , dtl.SECOND);
+}
+
+
+void
+recovery_set_last(
+    RecoveryInfo * info
+    , const Glass * glass)
+{
+    info->has_record = true;
+    info->last_id = glass->id;
+    glue_end_timestamp(
+        glass
+        , info->last_timestamp
+        , sizeof(info->last_timestamp));
+}
+
+
+bool
+recovery_is_last(
+    const RecoveryInfo * info
+    , const Glass * glass)
+{
+    char timestamp[sizeof(info->last_timestamp)];
+
+    if(info->has_record == false || info->last_id != glass->id)
+        return false;
+
+    glue_end_timestamp(glass, timestamp, sizeof(timestamp));
+
+    return strcmp(timestamp, info->last_timestamp) == 0;
+}
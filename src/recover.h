@@ -0,0 +1,82 @@
+#ifndef _RECOVER_H_
+#define _RECOVER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include "csv.h"
+
+
+/*
+** Maximal size of the end of csv file which is examined during recovery.
+** It holds many csv lines, so the last complete line is always found in it.
+*/
+#define RECOVERY_WINDOW 65536
+
+
+/*
+** Result of recovery of csv file
+*/
+typedef struct
+{
+    off_t size;
+    off_t truncated;
+    bool terminated;
+    bool has_record;
+    uint32_t last_id;
+    char last_timestamp[32];
+}RecoveryInfo;
+
+
+/*
+** Recovery of the end of csv file after restart. Only the last
+** RECOVERY_WINDOW bytes are mapped, so the time does not depend on file
+** size. Torn partial line is truncated, complete last line without
+** line terminator (files written before lines were terminated) gets one.
+** Id and timestamp of the last stored glass are returned in info.
+** Returns false when the file can not be examined or repaired, missing
+** file is not an error.
+*/
+bool
+recover_csv_tail(
+    const CsvMaker * csv_maker
+    , const char * path
+    , RecoveryInfo * info);
+
+
+/*
+** Storing of id and time of the end of glue application of glass as the
+** last record, so glass stored during this run is recognised in the same
+** way as the record found by recovery
+*/
+void
+recovery_set_last(
+    RecoveryInfo * info
+    , const Glass * glass);
+
+
+/*
+** Check if glass is the last record. Id alone is not enough, PLC can
+** leave it unset or reset its counter, so time of the end of glue
+** application (with resolution of csv file) has to match too.
+*/
+bool
+recovery_is_last(
+    const RecoveryInfo * info
+    , const Glass * glass);
+
+
+/*
+** Reading of glass id from csv line between begin and end, line terminator
+** is not included. Returns false when the id column is missing or invalid.
+*/
+bool
+recover_line_id(
+    char separator
+    , const char * begin
+    , const char * end
+    , uint32_t * id);
+
+
+#endif
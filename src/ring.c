@@ -0,0 +1,526 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ring.h"
+
+
+/*
+** Size of shared memory object for given number of slots
+*/
+static size_t
+ring_size(uint32_t slot_count)
+{
+    return sizeof(RingHeader) + (size_t) slot_count * sizeof(RingSlot);
+}
+
+
+static uint32_t
+round_up_power_of_two(uint32_t n)
+{
+    uint32_t result = 1;
+
+    while(result < n && result < (1u << 31))
+        result <<= 1;
+
+    return result;
+}
+
+
+/*
+** Check of header of existing ring which was not retired
+*/
+static bool
+ring_header_valid(
+    const RingHeader * header
+    , size_t size)
+{
+    return header->magic == RING_MAGIC
+        && header->version == RING_VERSION
+        && header->slot_size == sizeof(RingSlot)
+        && header->slot_count > 0
+        && (header->slot_count & (header->slot_count - 1)) == 0
+        && ring_size(header->slot_count) <= size
+        && atomic_load_explicit(
+            &header->generation
+            , memory_order_acquire) != RING_RETIRED;
+}
+
+
+/*
+** Retiring of ring, its readers attach to ring created under the same
+** name. Objects of other versions are only removed.
+*/
+static void
+ring_retire(
+    int fd
+    , const char * name
+    , size_t size)
+{
+    if(size >= sizeof(RingHeader))
+    {
+        RingHeader * header =
+            mmap(
+                NULL
+                , sizeof(RingHeader)
+                , PROT_READ | PROT_WRITE
+                , MAP_SHARED
+                , fd
+                , 0);
+
+        if(header != MAP_FAILED)
+        {
+            if(header->magic == RING_MAGIC && header->version == RING_VERSION)
+                atomic_store_explicit(
+                    &header->generation
+                    , RING_RETIRED
+                    , memory_order_release);
+
+            munmap(header, sizeof(RingHeader));
+        }
+    }
+
+    shm_unlink(name);
+}
+
+
+/*
+** Generation of new ring, it differs from generations of previous rings
+** with the same name
+*/
+static uint64_t
+ring_generation(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    uint64_t generation =
+        (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+
+    return generation != RING_RETIRED ? generation : 1;
+}
+
+
+/*
+** Mapping of existing ring for reading
+*/
+static bool
+ring_map(
+    const char * name
+    , int * fd
+    , size_t * size
+    , const RingHeader ** header)
+{
+    *fd = shm_open(name, O_RDONLY, 0);
+
+    if(*fd < 0)
+        return false;
+
+    struct stat st;
+
+    if(fstat(*fd, &st) != 0
+        || (size_t) st.st_size < sizeof(RingHeader))
+    {
+        close(*fd);
+        return false;
+    }
+
+    *size = (size_t) st.st_size;
+
+    void * memory = mmap(NULL, *size, PROT_READ, MAP_SHARED, *fd, 0);
+
+    if(memory == MAP_FAILED)
+    {
+        close(*fd);
+        return false;
+    }
+
+    *header = memory;
+
+    if(ring_header_valid(*header, *size) == false)
+    {
+        munmap(memory, *size);
+        close(*fd);
+        return false;
+    }
+
+    return true;
+}
+
+
+bool
+ring_writer_open(
+    RingWriter * writer
+    , const char * name
+    , uint32_t slot_count)
+{
+    slot_count = round_up_power_of_two(slot_count);
+
+    size_t size = ring_size(slot_count);
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    struct stat st;
+
+    if(fd < 0)
+        return false;
+
+    if(fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    void * memory = MAP_FAILED;
+
+    if((size_t) st.st_size == size)
+        memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if(memory != MAP_FAILED
+        && ring_header_valid(memory, size) == true
+        && ((RingHeader *) memory)->slot_count == slot_count)
+    {
+        writer->fd = fd;
+        writer->size = size;
+        writer->header = memory;
+        writer->slots = (RingSlot *) ((char *) memory + sizeof(RingHeader));
+
+        return true;
+    }
+
+    // readers of existing ring keep their mapping, so it is never resized
+    if(memory != MAP_FAILED)
+        munmap(memory, size);
+
+    ring_retire(fd, name, (size_t) st.st_size);
+    close(fd);
+
+    fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+
+    if(fd < 0)
+        return false;
+
+    if(ftruncate(fd, (off_t) size) != 0
+        || (memory =
+            mmap(
+                NULL
+                , size
+                , PROT_READ | PROT_WRITE
+                , MAP_SHARED
+                , fd
+                , 0)) == MAP_FAILED)
+    {
+        close(fd);
+        shm_unlink(name);
+        return false;
+    }
+
+    writer->fd = fd;
+    writer->size = size;
+    writer->header = memory;
+    writer->slots = (RingSlot *) ((char *) memory + sizeof(RingHeader));
+    writer->header->version = RING_VERSION;
+    writer->header->slot_count = slot_count;
+    writer->header->slot_size = sizeof(RingSlot);
+    atomic_store_explicit(&writer->header->head, 0, memory_order_relaxed);
+    atomic_store_explicit(
+        &writer->header->generation
+        , ring_generation()
+        , memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    writer->header->magic = RING_MAGIC;
+
+    return true;
+}
+
+
+uint64_t
+ring_publish(
+    RingWriter * writer
+    , const char record[DB_GLASS_STRUCT_SIZE])
+{
+    uint64_t sequence =
+        atomic_load_explicit(&writer->header->head, memory_order_relaxed);
+    RingSlot * slot =
+        &writer->slots[sequence & (writer->header->slot_count - 1)];
+
+    atomic_store_explicit(
+        &slot->sequence
+        , 2 * sequence + 1
+        , memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    memcpy(slot->record, record, DB_GLASS_STRUCT_SIZE);
+
+    atomic_store_explicit(
+        &slot->sequence
+        , 2 * sequence + 2
+        , memory_order_release);
+    atomic_store_explicit(
+        &writer->header->head
+        , sequence + 1
+        , memory_order_release);
+
+    return sequence;
+}
+
+
+void
+ring_writer_close(
+    RingWriter * writer
+    , const char * name
+    , bool unlink)
+{
+    if(unlink == true)
+    {
+        atomic_store_explicit(
+            &writer->header->generation
+            , RING_RETIRED
+            , memory_order_release);
+        shm_unlink(name);
+    }
+
+    munmap(writer->header, writer->size);
+    close(writer->fd);
+}
+
+
+bool
+ring_reader_open(
+    RingReader * reader
+    , const char * name)
+{
+    int fd;
+    size_t size;
+    const RingHeader * header;
+
+    if(strlen(name) >= sizeof(reader->name)
+        || ring_map(name, &fd, &size, &header) == false)
+        return false;
+
+    reader->fd = fd;
+    reader->size = size;
+    reader->header = header;
+    reader->slots =
+        (const RingSlot *) ((const char *) header + sizeof(RingHeader));
+    snprintf(reader->name, sizeof(reader->name), "%s", name);
+    reader->generation =
+        atomic_load_explicit(
+            &header->generation
+            , memory_order_acquire);
+    reader->reset = false;
+    reader->position =
+        atomic_load_explicit(
+            &header->head
+            , memory_order_acquire);
+    reader->lost = 0;
+    reader->peeked = 0;
+
+    return true;
+}
+
+
+/*
+** Attaching of reader to ring created again under the same name. Returns
+** true when reader was moved to the new ring.
+*/
+static bool
+ring_reader_resync(RingReader * reader)
+{
+    uint64_t generation =
+        atomic_load_explicit(
+            &reader->header->generation
+            , memory_order_acquire);
+
+    if(generation == reader->generation)
+        return false;
+
+    int fd;
+    size_t size;
+    const RingHeader * header;
+
+    if(ring_map(reader->name, &fd, &size, &header) == false)
+        return false;
+
+    generation =
+        atomic_load_explicit(
+            &header->generation
+            , memory_order_acquire);
+
+    if(generation == reader->generation)
+    {
+        munmap((void *) header, size);
+        close(fd);
+        return false;
+    }
+
+    ring_reader_close(reader);
+
+    reader->fd = fd;
+    reader->size = size;
+    reader->header = header;
+    reader->slots =
+        (const RingSlot *) ((const char *) header + sizeof(RingHeader));
+    reader->generation = generation;
+    reader->reset = true;
+    reader->position = 0;
+    reader->peeked = 0;
+
+    return true;
+}
+
+
+uint64_t
+ring_reader_pending(RingReader * reader)
+{
+    uint64_t head =
+        atomic_load_explicit(
+            &reader->header->head
+            , memory_order_acquire);
+
+    // records left in retired ring are read before reader moves on
+    if(head <= reader->position && ring_reader_resync(reader) == true)
+        head =
+            atomic_load_explicit(
+                &reader->header->head
+                , memory_order_acquire);
+
+    return head > reader->position ? head - reader->position : 0;
+}
+
+
+/*
+** Moving of reader which fell behind writer to the oldest record still
+** stored in the ring
+*/
+static void
+ring_reader_skip(RingReader * reader)
+{
+    uint64_t head =
+        atomic_load_explicit(
+            &reader->header->head
+            , memory_order_acquire);
+    uint64_t oldest =
+        head > reader->header->slot_count
+            ? head - reader->header->slot_count
+            : 0;
+
+    if(oldest > reader->position)
+    {
+        reader->lost += oldest - reader->position;
+        reader->position = oldest;
+    }
+}
+
+
+static const RingSlot *
+ring_reader_slot(const RingReader * reader)
+{
+    return
+        &reader->slots[reader->position & (reader->header->slot_count - 1)];
+}
+
+
+RingStatus
+ring_reader_peek(
+    RingReader * reader
+    , GlassView * glass
+    , uint64_t * sequence)
+{
+    uint64_t pending = ring_reader_pending(reader);
+
+    if(reader->reset == true)
+    {
+        reader->reset = false;
+        return RingReset;
+    }
+
+    if(pending == 0)
+        return RingEmpty;
+
+    if(pending > reader->header->slot_count)
+    {
+        ring_reader_skip(reader);
+        return RingLagged;
+    }
+
+    const RingSlot * slot = ring_reader_slot(reader);
+    uint64_t expected = 2 * reader->position + 2;
+    uint64_t current =
+        atomic_load_explicit(
+            &slot->sequence
+            , memory_order_acquire);
+
+    if(current != expected)
+    {
+        ring_reader_skip(reader);
+        return current > expected ? RingLagged : RingEmpty;
+    }
+
+    reader->peeked = expected;
+    glass->data = slot->record;
+
+    if(sequence != NULL)
+        *sequence = reader->position;
+
+    return RingOK;
+}
+
+
+RingStatus
+ring_reader_release(RingReader * reader)
+{
+    const RingSlot * slot = ring_reader_slot(reader);
+
+    atomic_thread_fence(memory_order_acquire);
+
+    uint64_t current =
+        atomic_load_explicit(
+            &slot->sequence
+            , memory_order_relaxed);
+
+    if(current != reader->peeked)
+    {
+        ring_reader_skip(reader);
+        return RingLagged;
+    }
+
+    reader->position++;
+
+    return RingOK;
+}
+
+
+RingStatus
+ring_reader_read(
+    RingReader * reader
+    , Glass * glass
+    , uint64_t * sequence)
+{
+    GlassView shared;
+    char record[DB_GLASS_STRUCT_SIZE];
+    RingStatus status = ring_reader_peek(reader, &shared, sequence);
+
+    if(status != RingOK)
+        return status;
+
+    memcpy(record, shared.data, sizeof(record));
+    status = ring_reader_release(reader);
+
+    if(status == RingOK)
+        read_glass_structure(sizeof(record), record, glass);
+
+    return status;
+}
+
+
+void
+ring_reader_close(RingReader * reader)
+{
+    munmap((void *) reader->header, reader->size);
+    close(reader->fd);
+}
@@ -0,0 +1,221 @@
+#ifndef _RING_H_
+#define _RING_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#include "glass.h"
+#include "glass_view.h"
+
+
+/*
+** Shared memory ring for publishing of glass records to local reader
+** processes.
+**
+** Layout of the shared memory object, integers are 64-bit lock-free
+** atomics or plain integers in host byte order:
+**
+**   offset 0     header (RING_HEADER_SIZE bytes)
+**                  0  uint32 magic RING_MAGIC
+**                  4  uint32 version RING_VERSION
+**                  8  uint32 slot_count, power of two
+**                 12  uint32 slot_size RING_SLOT_SIZE
+**                 16  uint64 head
+**                 24  uint64 generation
+**   offset 64    slot_count slots of RING_SLOT_SIZE bytes
+**                  0  uint64 sequence
+**                  8  raw PLC record of DB_GLASS_STRUCT_SIZE bytes, big
+**                     endian with fields at GLASS_OFFSET_* (glass_view.h)
+**
+** Record is not decoded into Glass structure, its bit fields and enums
+** depend on compiler, the raw record has the same layout for every
+** reader. There is exactly one writer. Record with sequence number n (counted
+** from 0) is stored in slot n & (slot_count - 1). Slot sequence word is
+** 2n+1 while record n is being written and 2n+2 once it is complete.
+** Header head is number of completed records. Readers never write into
+** shared memory, so any number of them can follow the ring without locks.
+** Reader which is more than slot_count records behind writer has lost
+** records and is moved forward to the oldest record still in the ring.
+**
+** Header generation identifies one incarnation of the ring. Writer never
+** resets sequence of existing ring, it retires it by setting generation
+** to RING_RETIRED and creates new shared memory object with new
+** generation under the same name. Readers which see changed generation
+** attach to the new object and continue with its first record.
+*/
+#define RING_MAGIC 0x52565343u
+#define RING_VERSION 3
+#define RING_ALIGNMENT 64
+#define RING_HEADER_SIZE 64
+#define RING_SLOT_SIZE 320
+#define RING_DEFAULT_SLOTS 1024
+#define RING_RETIRED 0
+#define RING_NAME_SIZE 256
+
+
+/*
+** Header of shared memory ring
+*/
+typedef struct
+{
+    _Alignas(RING_ALIGNMENT) uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_size;
+    _Atomic uint64_t head;
+    _Atomic uint64_t generation;
+}RingHeader;
+
+
+/*
+** One slot of shared memory ring
+*/
+typedef struct
+{
+    _Alignas(RING_ALIGNMENT) _Atomic uint64_t sequence;
+    char record[DB_GLASS_STRUCT_SIZE];
+}RingSlot;
+
+
+/*
+** Readers map the ring read only, so atomic loads must be plain loads
+*/
+_Static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "64-bit atomics are not lock-free");
+_Static_assert(sizeof(RingHeader) == RING_HEADER_SIZE, "ring header layout");
+_Static_assert(offsetof(RingHeader, head) == 16, "ring header layout");
+_Static_assert(offsetof(RingHeader, generation) == 24, "ring header layout");
+_Static_assert(sizeof(RingSlot) == RING_SLOT_SIZE, "ring slot layout");
+_Static_assert(offsetof(RingSlot, record) == 8, "ring slot layout");
+
+
+/*
+** Results of ring reader operations
+*/
+typedef enum
+{
+    RingOK
+    , RingEmpty
+    , RingLagged
+    , RingReset
+}RingStatus;
+
+
+/*
+** Writer side of the ring
+*/
+typedef struct
+{
+    int fd;
+    size_t size;
+    RingHeader * header;
+    RingSlot * slots;
+}RingWriter;
+
+
+/*
+** Reader side of the ring. Position is sequence number of next record
+** to be read, lost is number of records overwritten before they were read.
+** Name and generation are kept for attaching to re-created ring.
+*/
+typedef struct
+{
+    int fd;
+    size_t size;
+    const RingHeader * header;
+    const RingSlot * slots;
+    char name[RING_NAME_SIZE];
+    uint64_t generation;
+    bool reset;
+    uint64_t position;
+    uint64_t lost;
+    uint64_t peeked;
+}RingReader;
+
+
+/*
+** Creation or reopening of shared memory ring with given name (e.g.
+** "/csv_maker"). Slot count is rounded up to power of two. When ring
+** with the same layout already exists the writer continues its sequence,
+** ring with other layout is retired and created again.
+*/
+bool
+ring_writer_open(
+    RingWriter * writer
+    , const char * name
+    , uint32_t slot_count);
+
+
+/*
+** Publishing of new raw PLC record. Returns its sequence number.
+*/
+uint64_t
+ring_publish(
+    RingWriter * writer
+    , const char record[DB_GLASS_STRUCT_SIZE]);
+
+
+/*
+** Closing of writer, shared memory object is retired and removed when
+** unlink is set
+*/
+void
+ring_writer_close(
+    RingWriter * writer
+    , const char * name
+    , bool unlink);
+
+
+/*
+** Attaching of reader to existing ring. Reader starts with the next
+** published record.
+*/
+bool
+ring_reader_open(
+    RingReader * reader
+    , const char * name);
+
+
+/*
+** Zero copy access to the next record. Returned view points directly
+** into shared memory and the record must be confirmed by
+** ring_reader_release(), which reports RingLagged when the record was
+** overwritten while it was being used. RingReset is reported once after
+** reader attached to re-created ring, its sequence starts from 0 again.
+*/
+RingStatus
+ring_reader_peek(
+    RingReader * reader
+    , GlassView * glass
+    , uint64_t * sequence);
+
+
+RingStatus
+ring_reader_release(RingReader * reader);
+
+
+/*
+** Copy of the next record decoded into Glass structure owned by caller
+*/
+RingStatus
+ring_reader_read(
+    RingReader * reader
+    , Glass * glass
+    , uint64_t * sequence);
+
+
+/*
+** Number of published records which were not read yet. Reader which read
+** all records of retired ring attaches here to re-created ring, until it
+** is created every call tries to open it.
+*/
+uint64_t
+ring_reader_pending(RingReader * reader);
+
+
+void
+ring_reader_close(RingReader * reader);
+
+
+#endif
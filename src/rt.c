@@ -0,0 +1,342 @@
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+#include "rt.h"
+
+
+#define NS_PER_SECOND 1000000000L
+
+
+/*
+** Touching of stack pages, so later growth of stack never page faults
+*/
+static void __attribute__((noinline))
+prefault_stack(void)
+{
+    volatile char stack[RT_STACK_PREFAULT];
+
+    for(size_t i = 0; i < sizeof(stack); i += 4096)
+        stack[i] = 0;
+}
+
+
+/*
+** Locking of memory is process wide, so it is done only by the first
+** real-time thread
+*/
+static pthread_once_t lock_once = PTHREAD_ONCE_INIT;
+static int lock_error = 0;
+
+
+static void
+lock_memory(void)
+{
+    if(mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        lock_error = errno;
+}
+
+
+bool
+rt_setup(
+    const RtOptions * options
+    , FILE * error)
+{
+    bool result = true;
+
+    pthread_once(&lock_once, lock_memory);
+
+    if(lock_error != 0)
+    {
+        fprintf(error, "mlockall failed: %s\n", strerror(lock_error));
+        result = false;
+    }
+
+    prefault_stack();
+
+    if(options->cpu >= 0)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(options->cpu, &set);
+
+        int status =
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+        if(status != 0)
+        {
+            fprintf(
+                error
+                , "Pinning to CPU %d failed: %s\n"
+                , options->cpu
+                , strerror(status));
+            result = false;
+        }
+    }
+
+    if(options->priority > 0)
+    {
+        struct sched_param param = {.sched_priority = options->priority};
+        int status =
+            pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+        if(status != 0)
+        {
+            fprintf(
+                error
+                , "SCHED_FIFO priority %d failed: %s\n"
+                , options->priority
+                , strerror(status));
+            result = false;
+        }
+    }
+
+    return result;
+}
+
+
+void
+latency_histogram_init(LatencyHistogram * histogram)
+{
+    for(size_t i = 0; i < RT_HISTOGRAM_BUCKETS; i++)
+        atomic_init(&histogram->buckets[i], 0);
+
+    atomic_init(&histogram->count, 0);
+    atomic_init(&histogram->max_ns, 0);
+    atomic_init(&histogram->sum_ns, 0);
+}
+
+
+void
+latency_histogram_add(
+    LatencyHistogram * histogram
+    , uint64_t latency_ns)
+{
+    uint64_t us = latency_ns / 1000;
+    size_t bucket = 0;
+
+    while(us > 0 && bucket < RT_HISTOGRAM_BUCKETS - 1)
+    {
+        us >>= 1;
+        bucket++;
+    }
+
+    atomic_fetch_add_explicit(
+        &histogram->buckets[bucket]
+        , 1
+        , memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(
+        &histogram->sum_ns
+        , latency_ns
+        , memory_order_relaxed);
+
+    if(latency_ns
+        > atomic_load_explicit(&histogram->max_ns, memory_order_relaxed))
+        atomic_store_explicit(
+            &histogram->max_ns
+            , latency_ns
+            , memory_order_relaxed);
+}
+
+
+uint64_t
+latency_histogram_percentile(
+    const LatencyHistogram * histogram
+    , double fraction)
+{
+    uint64_t count =
+        atomic_load_explicit(
+            &((LatencyHistogram *) histogram)->count
+            , memory_order_relaxed);
+    uint64_t limit = (uint64_t) (fraction * count);
+    uint64_t seen = 0;
+
+    for(size_t i = 0; i < RT_HISTOGRAM_BUCKETS; i++)
+    {
+        seen +=
+            atomic_load_explicit(
+                &((LatencyHistogram *) histogram)->buckets[i]
+                , memory_order_relaxed);
+
+        if(seen > limit || seen == count)
+            return ((uint64_t) 1 << i) * 1000;
+    }
+
+    return ((uint64_t) 1 << (RT_HISTOGRAM_BUCKETS - 1)) * 1000;
+}
+
+
+void
+latency_histogram_print(
+    const LatencyHistogram * histogram
+    , const char * name
+    , FILE * file)
+{
+    LatencyHistogram * h = (LatencyHistogram *) histogram;
+    uint64_t count = atomic_load_explicit(&h->count, memory_order_relaxed);
+
+    if(count == 0)
+        return;
+
+    fprintf(
+        file
+        , "%s: %llu samples, mean %llu us, p99 < %llu us, max %llu us\n"
+        , name
+        , (unsigned long long) count
+        , (unsigned long long)
+            (atomic_load_explicit(&h->sum_ns, memory_order_relaxed)
+                / count / 1000)
+        , (unsigned long long) (latency_histogram_percentile(h, 0.99) / 1000)
+        , (unsigned long long)
+            (atomic_load_explicit(&h->max_ns, memory_order_relaxed) / 1000));
+
+    for(size_t i = 0; i < RT_HISTOGRAM_BUCKETS; i++)
+    {
+        uint64_t n = atomic_load_explicit(&h->buckets[i], memory_order_relaxed);
+
+        if(n > 0)
+            fprintf(
+                file
+                , "  < %8llu us: %llu\n"
+                , (unsigned long long) ((uint64_t) 1 << i)
+                , (unsigned long long) n);
+    }
+}
+
+
+uint64_t
+rt_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * NS_PER_SECOND + (uint64_t) now.tv_nsec;
+}
+
+
+static void
+timespec_add(
+    struct timespec * t
+    , long ns)
+{
+    t->tv_nsec += ns;
+
+    while(t->tv_nsec >= NS_PER_SECOND)
+    {
+        t->tv_nsec -= NS_PER_SECOND;
+        t->tv_sec++;
+    }
+}
+
+
+static int64_t
+timespec_diff_ns(
+    const struct timespec * a
+    , const struct timespec * b)
+{
+    return (int64_t) (a->tv_sec - b->tv_sec) * NS_PER_SECOND
+        + (a->tv_nsec - b->tv_nsec);
+}
+
+
+void
+rt_cycle_init(
+    RtCycle * cycle
+    , long period_ns)
+{
+    clock_gettime(CLOCK_MONOTONIC, &cycle->next);
+    cycle->period_ns = period_ns;
+    cycle->overruns = 0;
+    timespec_add(&cycle->next, period_ns);
+}
+
+
+void
+rt_cycle_wait(
+    RtCycle * cycle
+    , LatencyHistogram * histogram)
+{
+    struct timespec now;
+
+    while(clock_nanosleep(
+        CLOCK_MONOTONIC
+        , TIMER_ABSTIME
+        , &cycle->next
+        , NULL) == EINTR)
+        ;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    int64_t latency = timespec_diff_ns(&now, &cycle->next);
+
+    if(histogram != NULL)
+        latency_histogram_add(histogram, latency > 0 ? (uint64_t) latency : 0);
+
+    timespec_add(&cycle->next, cycle->period_ns);
+
+    // deadlines missed by long cycle are skipped
+    while(timespec_diff_ns(&now, &cycle->next) > 0)
+    {
+        timespec_add(&cycle->next, cycle->period_ns);
+        cycle->overruns++;
+    }
+}
+
+
+void
+rt_queue_init(RtQueue * queue)
+{
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+
+    // storage is touched, so the first records do not page fault
+    memset(queue->records, 0, sizeof(queue->records));
+}
+
+
+bool
+rt_queue_push(
+    RtQueue * queue
+    , const char data[DB_GLASS_STRUCT_SIZE]
+    , time_t time
+    , bool repeated)
+{
+    uint64_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+
+    if(head - tail >= RT_QUEUE_SLOTS)
+        return false;
+
+    RtRecord * record = &queue->records[head & (RT_QUEUE_SLOTS - 1)];
+    memcpy(record->data, data, DB_GLASS_STRUCT_SIZE);
+    record->time = time;
+    record->repeated = repeated;
+
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+
+    return true;
+}
+
+
+bool
+rt_queue_pop(
+    RtQueue * queue
+    , RtRecord * record)
+{
+    uint64_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+
+    if(tail == head)
+        return false;
+
+    *record = queue->records[tail & (RT_QUEUE_SLOTS - 1)];
+
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+
+    return true;
+}
@@ -0,0 +1,178 @@
+#ifndef _RT_H_
+#define _RT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "glass.h"
+
+
+/*
+** Number of buckets of latency histogram, bucket i counts latencies from
+** 2^(i-1) to 2^i - 1 microseconds, the last one counts all longer ones
+*/
+#define RT_HISTOGRAM_BUCKETS 24
+
+/*
+** Size of stack which is touched in advance by real-time thread
+*/
+#define RT_STACK_PREFAULT (256 * 1024)
+
+/*
+** Number of records in queue from real-time thread, power of two
+*/
+#define RT_QUEUE_SLOTS 64
+
+
+/*
+** Options of real-time thread, cpu -1 keeps current affinity
+*/
+typedef struct
+{
+    int priority;
+    int cpu;
+    long period_ns;
+}RtOptions;
+
+
+/*
+** Histogram of latencies. It is written by one thread and can be read by
+** others at any time.
+*/
+typedef struct
+{
+    _Atomic uint64_t buckets[RT_HISTOGRAM_BUCKETS];
+    _Atomic uint64_t count;
+    _Atomic uint64_t max_ns;
+    _Atomic uint64_t sum_ns;
+}LatencyHistogram;
+
+
+/*
+** Periodic cycle with absolute deadlines on monotonic clock
+*/
+typedef struct
+{
+    struct timespec next;
+    long period_ns;
+    uint64_t overruns;
+}RtCycle;
+
+
+/*
+** Record handed over from real-time thread. Glass is kept as raw PLC
+** datablock, it is decoded by the thread which stores it. Repeated is set
+** when acknowledgement of previous request was lost, so the record can be
+** the previous glass requested again.
+*/
+typedef struct
+{
+    char data[DB_GLASS_STRUCT_SIZE];
+    time_t time;
+    bool repeated;
+}RtRecord;
+
+
+/*
+** Single producer single consumer queue with fixed storage. Real-time
+** thread pushes records without locks, allocation or system calls, other
+** thread pops them and does the blocking work.
+*/
+typedef struct
+{
+    _Alignas(64) _Atomic uint64_t head;
+    _Alignas(64) _Atomic uint64_t tail;
+    RtRecord records[RT_QUEUE_SLOTS];
+}RtQueue;
+
+
+/*
+** Switching of calling thread into real-time mode: memory is locked
+** (once per process), stack is pre-faulted, thread is pinned to given CPU and scheduled with
+** SCHED_FIFO. Steps which fail are reported into error stream and the
+** function returns false, remaining steps are still applied.
+*/
+bool
+rt_setup(
+    const RtOptions * options
+    , FILE * error);
+
+
+void
+latency_histogram_init(LatencyHistogram * histogram);
+
+
+void
+latency_histogram_add(
+    LatencyHistogram * histogram
+    , uint64_t latency_ns);
+
+
+/*
+** Latency below which given fraction of samples lies, estimated as upper
+** bound of histogram bucket
+*/
+uint64_t
+latency_histogram_percentile(
+    const LatencyHistogram * histogram
+    , double fraction);
+
+
+void
+latency_histogram_print(
+    const LatencyHistogram * histogram
+    , const char * name
+    , FILE * file);
+
+
+/*
+** Monotonic time in nanoseconds
+*/
+uint64_t
+rt_now_ns(void);
+
+
+void
+rt_cycle_init(
+    RtCycle * cycle
+    , long period_ns);
+
+
+/*
+** Sleeping until the next deadline of cycle. Wake up latency is added
+** into histogram. Missed deadlines are skipped and counted as overruns.
+*/
+void
+rt_cycle_wait(
+    RtCycle * cycle
+    , LatencyHistogram * histogram);
+
+
+void
+rt_queue_init(RtQueue * queue);
+
+
+/*
+** Copying of record into queue, false when queue is full
+*/
+bool
+rt_queue_push(
+    RtQueue * queue
+    , const char data[DB_GLASS_STRUCT_SIZE]
+    , time_t time
+    , bool repeated);
+
+
+/*
+** Copying of the oldest record out of queue, false when queue is empty
+*/
+bool
+rt_queue_pop(
+    RtQueue * queue
+    , RtRecord * record);
+
+
+#endif
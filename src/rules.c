@@ -0,0 +1,530 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rules.h"
+
+
+/*
+** Field of glass available to rules
+*/
+typedef struct
+{
+    const char * name;
+    double (*get)(GlassView glass);
+}RuleField;
+
+
+static double
+get_pistol_temp(GlassView glass)
+{
+    return glass_view_pistol_temp_during_app(glass);
+}
+
+
+static double
+get_pistol_min(GlassView glass)
+{
+    return glass_view_pistol_temperature_min(glass);
+}
+
+
+static double
+get_pistol_max(GlassView glass)
+{
+    return glass_view_pistol_temperature_max(glass);
+}
+
+
+static double
+get_pot_temp(GlassView glass)
+{
+    return glass_view_a_pot_temp_during_app(glass);
+}
+
+
+static double
+get_pot_min(GlassView glass)
+{
+    return glass_view_a_pot_temperature_min(glass);
+}
+
+
+static double
+get_pot_max(GlassView glass)
+{
+    return glass_view_a_pot_temperature_max(glass);
+}
+
+
+static double
+get_a_amount(GlassView glass)
+{
+    return glass_view_a_applied_glue_amount(glass);
+}
+
+
+static double
+get_b_amount(GlassView glass)
+{
+    return glass_view_b_applied_glue_amount(glass);
+}
+
+
+static double
+get_a_ratio(GlassView glass)
+{
+    return glass_view_a_application_ratio(glass);
+}
+
+
+static double
+get_b_ratio(GlassView glass)
+{
+    return glass_view_b_application_ratio(glass);
+}
+
+
+/*
+** Mix ratio of components A:B, 0 when B ratio is not set
+*/
+static double
+get_mix_ratio(GlassView glass)
+{
+    float b = glass_view_b_application_ratio(glass);
+
+    return b != 0.0f ? glass_view_a_application_ratio(glass) / (double) b : 0.0;
+}
+
+
+static double
+get_mixer_tube_life(GlassView glass)
+{
+    return glass_view_mixer_tube_life(glass);
+}
+
+
+static double
+get_humidity(GlassView glass)
+{
+    return glass_view_ambient_humidity(glass);
+}
+
+
+static double
+get_ambient_temp(GlassView glass)
+{
+    return glass_view_ambient_temperature(glass);
+}
+
+
+static double
+get_a_expired(GlassView glass)
+{
+    return glass_view_barrel_expiration(glass, GLASS_OFFSET_BARREL_A);
+}
+
+
+static double
+get_b_expired(GlassView glass)
+{
+    return glass_view_barrel_expiration(glass, GLASS_OFFSET_BARREL_B);
+}
+
+
+static double
+count_metralight(
+    GlassView glass
+    , MetralightStatus status)
+{
+    int count = 0;
+
+    for(size_t i = 0; i < 12; i++)
+        count += glass_view_metralight_zone(glass, i) == status;
+
+    return count;
+}
+
+
+static double
+get_metralight_nok(GlassView glass)
+{
+    return count_metralight(glass, MetralightNOK);
+}
+
+
+static double
+get_metralight_error(GlassView glass)
+{
+    return count_metralight(glass, MetralightError);
+}
+
+
+static double
+get_glue_result(GlassView glass)
+{
+    return glass_view_glue_application_result(glass);
+}
+
+
+static double
+get_primer_result(GlassView glass)
+{
+    return glass_view_primer_inspection_result(glass);
+}
+
+
+static double
+get_robot_success(GlassView glass)
+{
+    return glass_view_robot_complete_success(glass);
+}
+
+
+static double
+get_dispense_success(GlassView glass)
+{
+    return glass_view_dispense_complete_success(glass);
+}
+
+
+static double
+get_process_complete(GlassView glass)
+{
+    return glass_view_addhesive_process_complete(glass);
+}
+
+
+static double
+get_model(GlassView glass)
+{
+    return glass_view_vehicle_model(glass);
+}
+
+
+/*
+** Duration of glue application in seconds, -1 when times are not set.
+** Calendar arithmetic without time zone lookup keeps evaluation bounded
+** on real-time thread.
+*/
+static double
+get_glue_duration(GlassView glass)
+{
+    int64_t start =
+        dtl_to_civil_us(glass_view_dtl(glass, GLASS_OFFSET_GLUE_START_TIME));
+    int64_t end =
+        dtl_to_civil_us(glass_view_dtl(glass, GLASS_OFFSET_GLUE_END_TIME));
+
+    return start >= 0 && end >= 0 ? (end - start) / 1e6 : -1.0;
+}
+
+
+static const RuleField rule_fields[] =
+{
+    {"pistolTempDuringApp", get_pistol_temp}
+    , {"pistolTemperatureMin", get_pistol_min}
+    , {"pistolTemperatureMax", get_pistol_max}
+    , {"aPotTempDuringApp", get_pot_temp}
+    , {"aPotTemperatureMin", get_pot_min}
+    , {"aPotTemperatureMax", get_pot_max}
+    , {"aAppliedGlueAmount", get_a_amount}
+    , {"bAppliedGlueAmount", get_b_amount}
+    , {"aApplicationRatio", get_a_ratio}
+    , {"bApplicationRatio", get_b_ratio}
+    , {"mixRatio", get_mix_ratio}
+    , {"mixerTubeLife", get_mixer_tube_life}
+    , {"ambientHumidity", get_humidity}
+    , {"ambientTemperature", get_ambient_temp}
+    , {"aExpired", get_a_expired}
+    , {"bExpired", get_b_expired}
+    , {"metralightNok", get_metralight_nok}
+    , {"metralightError", get_metralight_error}
+    , {"glueApplicationResult", get_glue_result}
+    , {"primerInspectionResult", get_primer_result}
+    , {"robotCompleteSuccess", get_robot_success}
+    , {"dispenseCompleteSuccess", get_dispense_success}
+    , {"addhesiveProcessComplete", get_process_complete}
+    , {"vehicleModel", get_model}
+    , {"glueDuration", get_glue_duration}
+};
+
+
+#define RULE_FIELDS (sizeof(rule_fields) / sizeof(rule_fields[0]))
+
+_Static_assert(RULE_FIELDS <= 64, "fields of rule set mask");
+
+
+static int
+find_field(const char * name)
+{
+    for(size_t i = 0; i < RULE_FIELDS; i++)
+        if(strcmp(rule_fields[i].name, name) == 0)
+            return (int) i;
+
+    return -1;
+}
+
+
+static bool
+parse_action(
+    const char * text
+    , RuleAction * action)
+{
+    if(strcmp(text, "warn") == 0)
+        *action = RuleWarn;
+    else if(strcmp(text, "reject") == 0)
+        *action = RuleReject;
+    else if(strcmp(text, "fail") == 0)
+        *action = RuleFail;
+    else
+        return false;
+
+    return true;
+}
+
+
+static bool
+parse_operator(
+    const char * text
+    , RuleOperator * op)
+{
+    static const char * const operators[] = {"<", "<=", ">", ">=", "==", "!="};
+
+    for(size_t i = 0; i < sizeof(operators) / sizeof(operators[0]); i++)
+        if(strcmp(text, operators[i]) == 0)
+        {
+            *op = (RuleOperator) i;
+            return true;
+        }
+
+    return false;
+}
+
+
+/*
+** Compiling of one line of rule file, empty and comment lines are skipped
+*/
+static bool
+compile_line(
+    RuleSet * rules
+    , const char * line
+    , const char ** message)
+{
+    char action[16];
+    char name[RULE_NAME_SIZE];
+    char field[48];
+    char op[4];
+    char operand[48];
+    int length = 0;
+
+    while(*line == ' ' || *line == '\t')
+        line++;
+
+    if(*line == '\0' || *line == '#')
+        return true;
+
+    Rule rule = {0};
+
+    if(sscanf(
+            line
+            , "%15s %31s if %47s %3s %47s %n"
+            , action
+            , name
+            , field
+            , op
+            , operand
+            , &length) != 5
+        || line[length] != '\0')
+        *message = "expected <action> <name> if <field> <operator> <operand>";
+    else if(parse_action(action, &rule.action) == false)
+        *message = "unknown action";
+    else if(find_field(field) < 0)
+        *message = "unknown field";
+    else if(parse_operator(op, &rule.op) == false)
+        *message = "unknown operator";
+    else if(rules->count >= RULES_MAX)
+        *message = "too many rules";
+    else
+    {
+        char * end;
+
+        snprintf(rule.name, sizeof(rule.name), "%s", name);
+        rule.field = (uint8_t) find_field(field);
+        rule.operand = strtod(operand, &end);
+
+        if(end == operand || *end != '\0')
+        {
+            int other = find_field(operand);
+
+            if(other < 0)
+            {
+                *message = "operand is neither number nor field";
+                return false;
+            }
+
+            rule.field_operand = true;
+            rule.operand_field = (uint8_t) other;
+            rules->fields |= (uint64_t) 1 << other;
+        }
+
+        rules->fields |= (uint64_t) 1 << rule.field;
+        rules->rules[rules->count++] = rule;
+
+        return true;
+    }
+
+    return false;
+}
+
+
+bool
+rules_compile(
+    RuleSet * rules
+    , const char * text
+    , char * error
+    , size_t error_size)
+{
+    char line[256];
+    size_t number = 0;
+
+    rules->count = 0;
+    rules->fields = 0;
+
+    while(*text != '\0')
+    {
+        size_t length = strcspn(text, "\r\n");
+        const char * message = NULL;
+
+        number++;
+
+        if(length >= sizeof(line))
+            message = "line too long";
+        else
+        {
+            memcpy(line, text, length);
+            line[length] = '\0';
+            compile_line(rules, line, &message);
+        }
+
+        if(message != NULL)
+        {
+            snprintf(error, error_size, "line %zu: %s", number, message);
+            return false;
+        }
+
+        text += length;
+
+        if(*text == '\r')
+            text++;
+
+        if(*text == '\n')
+            text++;
+    }
+
+    return true;
+}
+
+
+bool
+rules_load(
+    RuleSet * rules
+    , const char * path
+    , char * error
+    , size_t error_size)
+{
+    FILE * file = fopen(path, "r");
+
+    if(file == NULL)
+    {
+        snprintf(error, error_size, "cannot open %s", path);
+        return false;
+    }
+
+    // one byte more than fits is read to detect too long file
+    char text[RULES_MAX * 256 + 1];
+    size_t length = fread(text, 1, sizeof(text), file);
+
+    fclose(file);
+
+    if(length == sizeof(text))
+    {
+        snprintf(error, error_size, "%s is too long", path);
+        return false;
+    }
+
+    text[length] = '\0';
+
+    return rules_compile(rules, text, error, error_size);
+}
+
+
+RuleAction
+rules_evaluate(
+    const RuleSet * rules
+    , GlassView glass
+    , RuleVerdict * verdict)
+{
+    double values[RULE_FIELDS];
+
+    for(size_t i = 0; i < RULE_FIELDS; i++)
+        if((rules->fields >> i) & 1)
+            values[i] = rule_fields[i].get(glass);
+
+    *verdict = (RuleVerdict) {.action = RulePass};
+
+    for(size_t i = 0; i < rules->count; i++)
+    {
+        const Rule * rule = &rules->rules[i];
+        double a = values[rule->field];
+        double b =
+            rule->field_operand == true
+                ? values[rule->operand_field]
+                : rule->operand;
+        bool triggered = false;
+
+        switch(rule->op)
+        {
+            case RuleLess: triggered = a < b; break;
+            case RuleLessEqual: triggered = a <= b; break;
+            case RuleGreater: triggered = a > b; break;
+            case RuleGreaterEqual: triggered = a >= b; break;
+            case RuleEqual: triggered = a == b; break;
+            case RuleNotEqual: triggered = a != b; break;
+        }
+
+        if(triggered == false)
+            continue;
+
+        verdict->triggered |= (uint64_t) 1 << i;
+
+        if(rule->action > verdict->action)
+        {
+            verdict->action = rule->action;
+            verdict->rule = i;
+        }
+    }
+
+    return verdict->action;
+}
+
+
+const char *
+rule_action_to_string(RuleAction action)
+{
+    switch(action)
+    {
+        case RuleWarn:
+            return "warn";
+
+        case RuleReject:
+            return "reject";
+
+        case RuleFail:
+            return "fail";
+
+        default:
+            return "pass";
+    }
+}
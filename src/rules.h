@@ -0,0 +1,134 @@
+#ifndef _RULES_H_
+#define _RULES_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "glass.h"
+#include "glass_view.h"
+
+
+/*
+** Validation rules of glass record.
+**
+** Rule file has one rule per line, empty lines and lines starting with #
+** are ignored:
+**
+**   <action> <name> if <field> <operator> <operand>
+**
+** action is warn, reject or fail, operator is one of < <= > >= == != and
+** operand is number or another field, e.g.
+**
+**   fail pistol_cold if pistolTempDuringApp < pistolTemperatureMin
+**   reject barrel_a if aExpired == 1
+**   warn humidity if ambientHumidity > 70
+**
+** Rule triggers when its condition is true. Rules are compiled into flat
+** plan: used fields are read once and every rule is one comparison, so
+** evaluation is bounded by RULES_MAX comparisons.
+*/
+#define RULES_MAX 64
+#define RULE_NAME_SIZE 32
+
+
+/*
+** Actions of rules ordered by severity
+*/
+typedef enum
+{
+    RulePass
+    , RuleWarn
+    , RuleReject
+    , RuleFail
+}RuleAction;
+
+
+typedef enum
+{
+    RuleLess
+    , RuleLessEqual
+    , RuleGreater
+    , RuleGreaterEqual
+    , RuleEqual
+    , RuleNotEqual
+}RuleOperator;
+
+
+/*
+** One compiled rule
+*/
+typedef struct
+{
+    char name[RULE_NAME_SIZE];
+    RuleAction action;
+    RuleOperator op;
+    uint8_t field;
+    bool field_operand;
+    uint8_t operand_field;
+    double operand;
+}Rule;
+
+
+/*
+** Compiled rule set, fields is mask of fields read by rules
+*/
+typedef struct
+{
+    size_t count;
+    uint64_t fields;
+    Rule rules[RULES_MAX];
+}RuleSet;
+
+
+/*
+** Result of evaluation: the most severe action, mask of triggered rules
+** and index of the first rule with the most severe action
+*/
+typedef struct
+{
+    RuleAction action;
+    uint64_t triggered;
+    size_t rule;
+}RuleVerdict;
+
+
+/*
+** Compiling of rules from text. Error message with line number is written
+** into error buffer when text is invalid.
+*/
+bool
+rules_compile(
+    RuleSet * rules
+    , const char * text
+    , char * error
+    , size_t error_size);
+
+
+/*
+** Loading and compiling of rule file
+*/
+bool
+rules_load(
+    RuleSet * rules
+    , const char * path
+    , char * error
+    , size_t error_size);
+
+
+/*
+** Evaluation of all rules for glass record. Only fields used by rules are
+** decoded from the view.
+*/
+RuleAction
+rules_evaluate(
+    const RuleSet * rules
+    , GlassView glass
+    , RuleVerdict * verdict);
+
+
+const char *
+rule_action_to_string(RuleAction action);
+
+
+#endif
@@ -0,0 +1,468 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "spool.h"
+#include "recover.h"
+
+
+uint32_t
+crc32_update(
+    uint32_t crc
+    , const void * data
+    , size_t length)
+{
+    const unsigned char * p = data;
+
+    crc = ~crc;
+
+    while(length-- > 0)
+    {
+        crc ^= *p++;
+
+        for(int i = 0; i < 8; i++)
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+    }
+
+    return ~crc;
+}
+
+
+/*
+** Writing of whole buffer into file
+*/
+static bool
+write_all(
+    int fd
+    , const char * data
+    , size_t length)
+{
+    while(length > 0)
+    {
+        ssize_t n = write(fd, data, length);
+
+        if(n < 0)
+        {
+            if(errno == EINTR)
+                continue;
+
+            return false;
+        }
+
+        data += n;
+        length -= (size_t) n;
+    }
+
+    return true;
+}
+
+
+static bool
+make_directory(const char * path)
+{
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+
+static bool
+sync_directory(const char * path)
+{
+    int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if(fd < 0)
+        return false;
+
+    bool result = fsync(fd) == 0;
+    close(fd);
+
+    return result;
+}
+
+
+static bool
+join_path(
+    char * buffer
+    , size_t size
+    , const char * directory
+    , const char * name)
+{
+    int length = snprintf(buffer, size, "%s/%s", directory, name);
+
+    return length > 0 && (size_t) length < size;
+}
+
+
+/*
+** Writing of manifest of current segment into work directory
+*/
+static bool
+spool_write_manifest(
+    const Spool * spool
+    , const char * path)
+{
+    char manifest[512];
+    char ids[48] = "";
+    char sealed[24];
+    char opened[24];
+    time_t now = time(NULL);
+    struct tm tm;
+
+    localtime_r(&spool->opened, &tm);
+    strftime(opened, sizeof(opened), "%Y-%m-%d %H:%M:%S", &tm);
+    localtime_r(&now, &tm);
+    strftime(sealed, sizeof(sealed), "%Y-%m-%d %H:%M:%S", &tm);
+
+    // ids are left out when recovered segment has no parsable records
+    if(spool->has_id == true)
+        snprintf(
+            ids
+            , sizeof(ids)
+            , "first_id=%u\n"
+              "last_id=%u\n"
+            , (unsigned) spool->first_id
+            , (unsigned) spool->last_id);
+
+    int length =
+        snprintf(
+            manifest
+            , sizeof(manifest)
+            , "segment=%s\n"
+              "rows=%u\n"
+              "bytes=%llu\n"
+              "crc32=%08x\n"
+              "%s"
+              "opened=%s\n"
+              "sealed=%s\n"
+            , spool->segment
+            , (unsigned) spool->records
+            , (unsigned long long) spool->bytes
+            , (unsigned) spool->crc
+            , ids
+            , opened
+            , sealed);
+
+    if(length < 0 || (size_t) length >= sizeof(manifest))
+        return false;
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    if(fd < 0)
+        return false;
+
+    bool result =
+        write_all(fd, manifest, (size_t) length)
+        && fsync(fd) == 0;
+
+    return close(fd) == 0 && result;
+}
+
+
+bool
+spool_seal(Spool * spool)
+{
+    if(spool->fd < 0)
+        return true;
+
+    bool result = fsync(spool->fd) == 0;
+
+    if(close(spool->fd) != 0)
+        result = false;
+
+    spool->fd = -1;
+
+    char name[SPOOL_SEGMENT_NAME_SIZE + 16];
+    char work_segment[CSV_PATH_SIZE];
+    char work_manifest[CSV_PATH_SIZE];
+    char outbox_segment[CSV_PATH_SIZE];
+    char outbox_manifest[CSV_PATH_SIZE];
+
+    snprintf(name, sizeof(name), "%s.manifest", spool->segment);
+
+    if(join_path(
+            work_segment
+            , sizeof(work_segment)
+            , spool->work
+            , spool->segment) == false
+        || join_path(
+            work_manifest
+            , sizeof(work_manifest)
+            , spool->work
+            , name) == false
+        || join_path(
+            outbox_segment
+            , sizeof(outbox_segment)
+            , spool->outbox
+            , spool->segment) == false
+        || join_path(
+            outbox_manifest
+            , sizeof(outbox_manifest)
+            , spool->outbox
+            , name) == false)
+        return false;
+
+    return result
+        && spool_write_manifest(spool, work_manifest)
+        && rename(work_segment, outbox_segment) == 0
+        && rename(work_manifest, outbox_manifest) == 0
+        && sync_directory(spool->outbox)
+        && sync_directory(spool->work);
+}
+
+
+/*
+** Creation of new segment with csv header
+*/
+static bool
+spool_begin(
+    Spool * spool
+    , time_t now)
+{
+    char timestamp[24];
+    char path[CSV_PATH_SIZE];
+    struct tm tm;
+
+    localtime_r(&now, &tm);
+    strftime(timestamp, sizeof(timestamp), "%Y%m%d-%H%M%S", &tm);
+
+    int length =
+        snprintf(
+            spool->segment
+            , sizeof(spool->segment)
+            , "%s-%s-%06llu.csv"
+            , spool->csv_maker.name
+            , timestamp
+            , (unsigned long long) spool->sequence++);
+
+    if(length < 0
+        || (size_t) length >= sizeof(spool->segment)
+        || join_path(path, sizeof(path), spool->work, spool->segment) == false)
+        return false;
+
+    spool->fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+
+    if(spool->fd < 0)
+        return false;
+
+    char header[CSV_HEADER_SIZE];
+    size_t header_length =
+        format_csv_header(&spool->csv_maker, header, sizeof(header));
+
+    spool->opened = now;
+    spool->records = 0;
+    spool->bytes = header_length;
+    spool->crc = crc32_update(0, header, header_length);
+    spool->has_id = false;
+    spool->first_id = 0;
+    spool->last_id = 0;
+
+    return header_length > 0
+        && write_all(spool->fd, header, header_length);
+}
+
+
+/*
+** Publishing of manifest left in work directory after crash between
+** renames of segment and manifest
+*/
+static bool
+spool_publish_left(
+    const Spool * spool
+    , const char * name)
+{
+    char work_manifest[CSV_PATH_SIZE];
+    char outbox_manifest[CSV_PATH_SIZE];
+
+    return join_path(
+            work_manifest
+            , sizeof(work_manifest)
+            , spool->work
+            , name)
+        && join_path(
+            outbox_manifest
+            , sizeof(outbox_manifest)
+            , spool->outbox
+            , name)
+        && rename(work_manifest, outbox_manifest) == 0;
+}
+
+
+/*
+** Sealing of segment left in work directory after crash. Torn last line
+** is removed and manifest is computed from file content, the first id is
+** read from the first line after csv header.
+*/
+static bool
+spool_seal_left(
+    Spool * spool
+    , const char * name)
+{
+    char path[CSV_PATH_SIZE];
+    RecoveryInfo recovery;
+
+    if(join_path(path, sizeof(path), spool->work, name) == false
+        || recover_csv_tail(&spool->csv_maker, path, &recovery) == false)
+        return false;
+
+    if(recovery.size == 0)
+        return unlink(path) == 0;
+
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+
+    if(fd < 0)
+        return false;
+
+    snprintf(spool->segment, sizeof(spool->segment), "%s", name);
+    spool->fd = fd;
+    spool->opened = time(NULL);
+    spool->records = 0;
+    spool->bytes = 0;
+    spool->crc = 0;
+    spool->has_id = false;
+    spool->first_id = 0;
+    spool->last_id = recovery.last_id;
+
+    char buffer[65536];
+    char first[CSV_LINE_SIZE];
+    size_t first_length = 0;
+    ssize_t n;
+    uint64_t lines = 0;
+
+    while((n = read(fd, buffer, sizeof(buffer))) > 0)
+    {
+        spool->crc = crc32_update(spool->crc, buffer, (size_t) n);
+        spool->bytes += (uint64_t) n;
+
+        for(ssize_t i = 0; i < n; i++)
+        {
+            if(lines == 2 && first_length < sizeof(first))
+                first[first_length++] = buffer[i];
+
+            lines += buffer[i] == '\n';
+        }
+    }
+
+    spool->records = lines > 2 ? (uint32_t) (lines - 2) : 0;
+
+    const char * first_end = memchr(first, '\n', first_length);
+
+    spool->has_id =
+        recovery.has_record == true
+        && first_end != NULL
+        && recover_line_id(
+            spool->csv_maker.separator
+            , first
+            , first_end
+            , &spool->first_id);
+
+    return n == 0 && spool_seal(spool);
+}
+
+
+bool
+spool_open(
+    Spool * spool
+    , const CsvMaker * csv_maker
+    , const char * outbox
+    , uint32_t max_records
+    , time_t max_seconds)
+{
+    *spool = (Spool)
+        {.csv_maker = *csv_maker
+        , .max_records = max_records
+        , .max_seconds = max_seconds
+        , .fd = -1};
+
+    snprintf(spool->outbox, sizeof(spool->outbox), "%s", outbox);
+
+    if(join_path(spool->work, sizeof(spool->work), outbox, SPOOL_WORK_DIR)
+        == false
+        || make_directory(spool->outbox) == false
+        || make_directory(spool->work) == false)
+        return false;
+
+    DIR * directory = opendir(spool->work);
+
+    if(directory == NULL)
+        return false;
+
+    bool result = true;
+    struct dirent * entry;
+
+    while((entry = readdir(directory)) != NULL)
+    {
+        const char * extension = strrchr(entry->d_name, '.');
+
+        if(extension == NULL
+            || extension == entry->d_name
+            || strlen(entry->d_name) >= SPOOL_SEGMENT_NAME_SIZE)
+            continue;
+
+        if(strcmp(extension, ".manifest") == 0)
+            result = spool_publish_left(spool, entry->d_name) && result;
+        else if(strcmp(extension, ".csv") == 0)
+            result = spool_seal_left(spool, entry->d_name) && result;
+    }
+
+    closedir(directory);
+
+    return result;
+}
+
+
+bool
+spool_append(
+    Spool * spool
+    , const char * line
+    , size_t length
+    , uint32_t id
+    , time_t now)
+{
+    if(spool->fd < 0 && spool_begin(spool, now) == false)
+        return false;
+
+    if(write_all(spool->fd, line, length) == false)
+        return false;
+
+    spool->records++;
+    spool->bytes += length;
+    spool->crc = crc32_update(spool->crc, line, length);
+
+    if(spool->has_id == false)
+        spool->first_id = id;
+
+    spool->has_id = true;
+    spool->last_id = id;
+
+    if(spool->max_records > 0
+        && spool->records >= spool->max_records)
+        return spool_seal(spool);
+
+    return true;
+}
+
+
+bool
+spool_tick(
+    Spool * spool
+    , time_t now)
+{
+    if(spool->fd >= 0
+        && spool->max_seconds > 0
+        && now - spool->opened >= spool->max_seconds)
+        return spool_seal(spool);
+
+    return true;
+}
+
+
+bool
+spool_close(Spool * spool)
+{
+    return spool_seal(spool);
+}
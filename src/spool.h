@@ -0,0 +1,108 @@
+#ifndef _SPOOL_H_
+#define _SPOOL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "csv.h"
+
+
+/*
+** Name of directory inside outbox where segments are written before they
+** are sealed
+*/
+#define SPOOL_WORK_DIR ".work"
+#define SPOOL_SEGMENT_NAME_SIZE 128
+
+
+/*
+** Spool of csv segments for downstream consumers.
+**
+** Records are appended into segment in <outbox>/.work. Segment is sealed
+** when it reaches max_records or when it is older than max_seconds:
+** it is synchronized, its manifest <segment>.manifest with number of rows,
+** bytes, CRC-32 and glass ids is written, then the segment and after it
+** the manifest are moved into outbox by atomic rename. Consumers watch
+** outbox for new *.manifest files (IN_MOVED_TO), the segment it names is
+** complete and never changes again. Every segment starts with csv header.
+*/
+typedef struct
+{
+    CsvMaker csv_maker;
+    char outbox[CSV_PATH_SIZE];
+    char work[CSV_PATH_SIZE];
+    uint32_t max_records;
+    time_t max_seconds;
+    uint64_t sequence;
+    int fd;
+    char segment[SPOOL_SEGMENT_NAME_SIZE];
+    time_t opened;
+    uint32_t records;
+    uint64_t bytes;
+    uint32_t crc;
+    bool has_id;
+    uint32_t first_id;
+    uint32_t last_id;
+}Spool;
+
+
+/*
+** CRC-32 (IEEE 802.3) of data, crc is 0 for the first block
+*/
+uint32_t
+crc32_update(
+    uint32_t crc
+    , const void * data
+    , size_t length);
+
+
+/*
+** Opening of spool, directories are created when missing and segments
+** left in work directory by previous run are sealed
+*/
+bool
+spool_open(
+    Spool * spool
+    , const CsvMaker * csv_maker
+    , const char * outbox
+    , uint32_t max_records
+    , time_t max_seconds);
+
+
+/*
+** Appending of one csv line of glass with given id
+*/
+bool
+spool_append(
+    Spool * spool
+    , const char * line
+    , size_t length
+    , uint32_t id
+    , time_t now);
+
+
+/*
+** Sealing of current segment when it is older than max_seconds
+*/
+bool
+spool_tick(
+    Spool * spool
+    , time_t now);
+
+
+/*
+** Sealing and publishing of current segment
+*/
+bool
+spool_seal(Spool * spool);
+
+
+/*
+** Sealing of current segment and closing of spool
+*/
+bool
+spool_close(Spool * spool);
+
+
+#endif
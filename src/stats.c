@@ -0,0 +1,582 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <sys/stat.h>
+
+#include "stats.h"
+
+
+static const char * const metric_names[METRIC_COUNT] =
+{
+    "KomponenteA_Menge"
+    , "KomponenteB_Menge"
+    , "Mischungsverhaeltnis"
+    , "AppizierdueseTemp"
+    , "KomponenteA_Temp"
+};
+
+
+static const char * const metric_columns[] =
+{
+    "Mittel"
+    , "StdAbw"
+    , "Min"
+    , "Max"
+    , "P50"
+    , "P95"
+};
+
+
+/********************* P-square quantile estimator ***************/
+
+static void
+quantile_init(
+    Quantile * quantile
+    , double p)
+{
+    *quantile = (Quantile)
+        {.p = p
+        , .dn = {0, p / 2, p, (1 + p) / 2, 1}};
+}
+
+
+static void
+sort_small(
+    double * values
+    , size_t count)
+{
+    for(size_t i = 1; i < count; i++)
+    {
+        double value = values[i];
+        size_t j = i;
+
+        for(; j > 0 && values[j-1] > value; j--)
+            values[j] = values[j-1];
+
+        values[j] = value;
+    }
+}
+
+
+static double
+quantile_parabolic(
+    const Quantile * quantile
+    , int i
+    , double d)
+{
+    const double * q = quantile->q;
+    const double * n = quantile->n;
+
+    return q[i] + d / (n[i+1] - n[i-1])
+        * ((n[i] - n[i-1] + d) * (q[i+1] - q[i]) / (n[i+1] - n[i])
+          + (n[i+1] - n[i] - d) * (q[i] - q[i-1]) / (n[i] - n[i-1]));
+}
+
+
+static double
+quantile_linear(
+    const Quantile * quantile
+    , int i
+    , int d)
+{
+    const double * q = quantile->q;
+    const double * n = quantile->n;
+
+    return q[i] + d * (q[i+d] - q[i]) / (n[i+d] - n[i]);
+}
+
+
+static void
+quantile_add(
+    Quantile * quantile
+    , double x)
+{
+    double * q = quantile->q;
+    double * n = quantile->n;
+
+    if(quantile->count < 5)
+    {
+        q[quantile->count++] = x;
+
+        if(quantile->count == 5)
+        {
+            sort_small(q, 5);
+
+            double p = quantile->p;
+            for(int i = 0; i < 5; i++)
+                n[i] = i + 1;
+
+            quantile->np[0] = 1;
+            quantile->np[1] = 1 + 2 * p;
+            quantile->np[2] = 1 + 4 * p;
+            quantile->np[3] = 3 + 2 * p;
+            quantile->np[4] = 5;
+        }
+
+        return;
+    }
+
+    int k;
+
+    if(x < q[0])
+    {
+        q[0] = x;
+        k = 0;
+    }
+    else if(x >= q[4])
+    {
+        q[4] = x;
+        k = 3;
+    }
+    else
+    {
+        for(k = 0; k < 3 && x >= q[k+1]; k++)
+            ;
+    }
+
+    for(int i = k + 1; i < 5; i++)
+        n[i]++;
+
+    for(int i = 0; i < 5; i++)
+        quantile->np[i] += quantile->dn[i];
+
+    quantile->count++;
+
+    for(int i = 1; i < 4; i++)
+    {
+        double d = quantile->np[i] - n[i];
+
+        if((d >= 1 && n[i+1] - n[i] > 1)
+            || (d <= -1 && n[i-1] - n[i] < -1))
+        {
+            int sign = d > 0 ? 1 : -1;
+            double estimate = quantile_parabolic(quantile, i, sign);
+
+            if(q[i-1] < estimate && estimate < q[i+1])
+                q[i] = estimate;
+            else
+                q[i] = quantile_linear(quantile, i, sign);
+
+            n[i] += sign;
+        }
+    }
+}
+
+
+static double
+quantile_value(const Quantile * quantile)
+{
+    if(quantile->count == 0)
+        return NAN;
+
+    if(quantile->count >= 5)
+        return quantile->q[2];
+
+    double values[5];
+    memcpy(values, quantile->q, sizeof(values));
+    sort_small(values, quantile->count);
+
+    return values[(size_t) (quantile->p * (quantile->count - 1) + 0.5)];
+}
+
+
+/********************* running statistics ***************/
+
+void
+running_stats_init(RunningStats * stats)
+{
+    static const double p[STATS_QUANTILES] = STATS_QUANTILE_VALUES;
+
+    *stats = (RunningStats)
+        {.min = INFINITY
+        , .max = -INFINITY};
+
+    for(size_t i = 0; i < STATS_QUANTILES; i++)
+        quantile_init(&stats->quantiles[i], p[i]);
+}
+
+
+void
+running_stats_add(
+    RunningStats * stats
+    , double value)
+{
+    if(isfinite(value) == false)
+        return;
+
+    stats->count++;
+
+    double delta = value - stats->mean;
+    stats->mean += delta / stats->count;
+    stats->m2 += delta * (value - stats->mean);
+
+    if(value < stats->min)
+        stats->min = value;
+
+    if(value > stats->max)
+        stats->max = value;
+
+    for(size_t i = 0; i < STATS_QUANTILES; i++)
+        quantile_add(&stats->quantiles[i], value);
+}
+
+
+double
+running_stats_variance(const RunningStats * stats)
+{
+    return stats->count > 1 ? stats->m2 / (stats->count - 1) : 0;
+}
+
+
+double
+running_stats_quantile(
+    const RunningStats * stats
+    , size_t index)
+{
+    return quantile_value(&stats->quantiles[index]);
+}
+
+
+/********************* aggregation into time buckets ***************/
+
+static void
+model_summary_init(
+    ModelSummary * summary
+    , uint8_t model)
+{
+    *summary = (ModelSummary) {.model = model};
+
+    for(size_t i = 0; i < METRIC_COUNT; i++)
+        running_stats_init(&summary->metrics[i]);
+}
+
+
+void
+aggregator_init(
+    Aggregator * aggregator
+    , const CsvMaker * csv_maker
+    , const char * label
+    , time_t bucket_seconds
+    , time_t bucket_offset
+    , time_t now)
+{
+    aggregator->csv_maker = *csv_maker;
+    snprintf(aggregator->label, sizeof(aggregator->label), "%s", label);
+    aggregator->bucket_seconds = bucket_seconds > 0 ? bucket_seconds : 3600;
+    aggregator->bucket_offset = bucket_offset;
+    aggregator->started = now;
+    aggregator->bucket_start = 0;
+    aggregator->model_count = 0;
+}
+
+
+time_t
+aggregator_bucket(
+    const Aggregator * aggregator
+    , time_t t)
+{
+    struct tm tm;
+    localtime_r(&t, &tm);
+
+    time_t since_midnight = tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec;
+    time_t since_start =
+        (since_midnight - aggregator->bucket_offset)
+            % aggregator->bucket_seconds;
+
+    if(since_start < 0)
+        since_start += aggregator->bucket_seconds;
+
+    return t - since_start;
+}
+
+
+static ModelSummary *
+aggregator_model(
+    Aggregator * aggregator
+    , uint8_t model)
+{
+    for(size_t i = 0; i < aggregator->model_count; i++)
+    {
+        if(aggregator->models[i].model == model)
+            return &aggregator->models[i];
+    }
+
+    if(aggregator->model_count == AGGREGATOR_MODELS)
+        return &aggregator->models[AGGREGATOR_MODELS - 1];
+
+    ModelSummary * summary = &aggregator->models[aggregator->model_count++];
+    model_summary_init(summary, model);
+
+    return summary;
+}
+
+
+bool
+aggregator_add(
+    Aggregator * aggregator
+    , const Glass * glass
+    , time_t t)
+{
+    bool result = aggregator_tick(aggregator, t);
+
+    if(aggregator->model_count == 0)
+        aggregator->bucket_start = aggregator_bucket(aggregator, t);
+
+    ModelSummary * summary = aggregator_model(aggregator, glass->vehicleModel);
+    summary->count++;
+
+    running_stats_add(
+        &summary->metrics[MetricAGlueAmount]
+        , glass->aAppliedGlueAmount);
+    running_stats_add(
+        &summary->metrics[MetricBGlueAmount]
+        , glass->bAppliedGlueAmount);
+    running_stats_add(
+        &summary->metrics[MetricPistolTemperature]
+        , glass->pistolTempDuringApp);
+    running_stats_add(
+        &summary->metrics[MetricPotTemperature]
+        , glass->aPotTempDuringApp);
+
+    if(glass->bApplicationRatio != 0)
+        running_stats_add(
+            &summary->metrics[MetricMixRatio]
+            , (double) glass->aApplicationRatio / glass->bApplicationRatio);
+
+    if(glass->metralightEn == true)
+    {
+        summary->metralightChecked++;
+
+        for(size_t i = 0; i < 12; i++)
+        {
+            MetralightStatus status = glass->metralightZone[i];
+
+            summary->metralightInspected[i] +=
+                status == MetralightOK || status == MetralightNOK;
+            summary->metralightNok[i] += status == MetralightNOK;
+            summary->metralightError[i] += status == MetralightError;
+        }
+    }
+
+    return result;
+}
+
+
+bool
+aggregator_tick(
+    Aggregator * aggregator
+    , time_t t)
+{
+    if(aggregator->model_count > 0
+        && t >= aggregator->bucket_start + aggregator->bucket_seconds)
+        return aggregator_flush(aggregator, t);
+
+    return true;
+}
+
+
+/*
+** Writing of summary header into new file
+*/
+static void
+aggregator_store_header(
+    const Aggregator * aggregator
+    , FILE * file)
+{
+    char separator = aggregator->csv_maker.separator;
+
+    fprintf(
+        file
+        , "Start%cEnde%cVollstaendig%cFahrzeugModell%cAnzahl"
+        , separator
+        , separator
+        , separator
+        , separator);
+
+    for(size_t i = 0; i < METRIC_COUNT; i++)
+    {
+        for(size_t j = 0
+            ; j < sizeof(metric_columns) / sizeof(metric_columns[0])
+            ; j++)
+            fprintf(
+                file
+                , "%c%s_%s"
+                , separator
+                , metric_names[i]
+                , metric_columns[j]);
+    }
+
+    for(size_t i = 0; i < 12; i++)
+        fprintf(file, "%cMetralightZone%zu_NOK", separator, i + 1);
+
+    for(size_t i = 0; i < 12; i++)
+        fprintf(file, "%cMetralightZone%zu_Error", separator, i + 1);
+
+    fprintf(file, "\n");
+}
+
+
+static void
+aggregator_store_summary(
+    const Aggregator * aggregator
+    , const ModelSummary * summary
+    , bool complete
+    , FILE * file)
+{
+    char separator = aggregator->csv_maker.separator;
+    char start[24];
+    char end[24];
+    struct tm tm;
+    time_t end_time = aggregator->bucket_start + aggregator->bucket_seconds;
+
+    localtime_r(&aggregator->bucket_start, &tm);
+    strftime(start, sizeof(start), "%Y-%m-%d %H:%M:%S", &tm);
+    localtime_r(&end_time, &tm);
+    strftime(end, sizeof(end), "%Y-%m-%d %H:%M:%S", &tm);
+
+    fprintf(
+        file
+        , "%s%c%s%c%s%c%s%c%llu"
+        , start
+        , separator
+        , end
+        , separator
+        , complete ? "true" : "false"
+        , separator
+        , vehicle_model_to_string(summary->model)
+        , separator
+        , (unsigned long long) summary->count);
+
+    for(size_t i = 0; i < METRIC_COUNT; i++)
+    {
+        const RunningStats * stats = &summary->metrics[i];
+
+        if(stats->count == 0)
+        {
+            for(size_t j = 0
+                ; j < sizeof(metric_columns) / sizeof(metric_columns[0])
+                ; j++)
+                fprintf(file, "%cNaN", separator);
+
+            continue;
+        }
+
+        fprintf(
+            file
+            , "%c%f%c%f%c%f%c%f"
+            , separator
+            , stats->mean
+            , separator
+            , sqrt(running_stats_variance(stats))
+            , separator
+            , stats->min
+            , separator
+            , stats->max);
+
+        for(size_t j = 0; j < STATS_QUANTILES; j++)
+            fprintf(
+                file
+                , "%c%f"
+                , separator
+                , running_stats_quantile(stats, j));
+    }
+
+    for(size_t i = 0; i < 12; i++)
+    {
+        if(summary->metralightInspected[i] > 0)
+            fprintf(
+                file
+                , "%c%f"
+                , separator
+                , (double) summary->metralightNok[i]
+                    / summary->metralightInspected[i]);
+        else
+            fprintf(file, "%cNaN", separator);
+    }
+
+    for(size_t i = 0; i < 12; i++)
+    {
+        if(summary->metralightChecked > 0)
+            fprintf(
+                file
+                , "%c%f"
+                , separator
+                , (double) summary->metralightError[i]
+                    / summary->metralightChecked);
+        else
+            fprintf(file, "%cNaN", separator);
+    }
+
+    fprintf(file, "\n");
+}
+
+
+bool
+aggregator_flush(
+    Aggregator * aggregator
+    , time_t t)
+{
+    if(aggregator->model_count == 0)
+        return true;
+
+    bool complete =
+        aggregator->started <= aggregator->bucket_start
+        && t >= aggregator->bucket_start + aggregator->bucket_seconds;
+
+    CsvMaker summary_maker = aggregator->csv_maker;
+    int length =
+        snprintf(
+            summary_maker.name
+            , sizeof(summary_maker.name)
+            , "%s-%s"
+            , aggregator->csv_maker.name
+            , aggregator->label);
+    int path_length =
+        snprintf(
+            summary_maker.path
+            , sizeof(summary_maker.path)
+            , "%s/%s"
+            , aggregator->csv_maker.path
+            , AGGREGATOR_DIR);
+
+    if(length < 0
+        || (size_t) length >= sizeof(summary_maker.name)
+        || path_length < 0
+        || (size_t) path_length >= sizeof(summary_maker.path)
+        || (mkdir(summary_maker.path, 0755) != 0 && errno != EEXIST))
+    {
+        aggregator->model_count = 0;
+        return false;
+    }
+
+    char file_path[CSV_PATH_SIZE];
+    generate_csv_name(
+        &summary_maker
+        , aggregator->bucket_start
+        , file_path
+        , sizeof(file_path));
+
+    FILE * file = fopen(file_path, "a");
+    bool result = false;
+
+    if(file != NULL)
+    {
+        if(fseek(file, 0, SEEK_END) == 0 && ftell(file) == 0)
+            aggregator_store_header(aggregator, file);
+
+        for(size_t i = 0; i < aggregator->model_count; i++)
+            aggregator_store_summary(
+                aggregator
+                , &aggregator->models[i]
+                , complete
+                , file);
+
+        result = fclose(file) == 0;
+    }
+
+    aggregator->model_count = 0;
+
+    return result;
+}
@@ -0,0 +1,187 @@
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "glass.h"
+#include "csv.h"
+
+
+/*
+** Maximal number of vehicle models tracked in one time bucket, records of
+** further models are added into the last one
+*/
+#define AGGREGATOR_MODELS 8
+
+/*
+** Subdirectory of csv directory with summary files, they have other
+** columns than production csv files and must not match their pattern
+*/
+#define AGGREGATOR_DIR "summary"
+
+/*
+** Estimated quantiles of every metric
+*/
+#define STATS_QUANTILES 2
+#define STATS_QUANTILE_VALUES {0.5, 0.95}
+
+
+/*
+** Enum with aggregated process values
+*/
+typedef enum
+{
+    MetricAGlueAmount
+    , MetricBGlueAmount
+    , MetricMixRatio
+    , MetricPistolTemperature
+    , MetricPotTemperature
+    , METRIC_COUNT
+}Metric;
+
+
+/*
+** P-square estimator of one quantile in constant memory
+*/
+typedef struct
+{
+    double p;
+    uint64_t count;
+    double q[5];
+    double n[5];
+    double np[5];
+    double dn[5];
+}Quantile;
+
+
+/*
+** Running count, mean, variance (Welford), minimum, maximum and quantiles
+** of one metric
+*/
+typedef struct
+{
+    uint64_t count;
+    double mean;
+    double m2;
+    double min;
+    double max;
+    Quantile quantiles[STATS_QUANTILES];
+}RunningStats;
+
+
+/*
+** Summary of one vehicle model in one time bucket. NOK rate of Metralight
+** zone is related to glasses where the zone was inspected (OK or NOK),
+** error rate to all glasses checked by Metralight.
+*/
+typedef struct
+{
+    uint8_t model;
+    uint64_t count;
+    RunningStats metrics[METRIC_COUNT];
+    uint64_t metralightChecked;
+    uint64_t metralightInspected[12];
+    uint64_t metralightNok[12];
+    uint64_t metralightError[12];
+}ModelSummary;
+
+
+/*
+** Aggregation of records into time buckets of given length aligned to
+** local midnight plus offset (e.g. 3600/0 for hours, 28800/21600 for
+** shifts starting at 6:00). Summary of finished bucket is appended into
+** file <path>/summary/<name>-<label>-<date>.csv, the directory is created
+** when missing.
+**
+** Column Vollstaendig is false for partial bucket: bucket which started
+** before the aggregator (restart, reload) or which was flushed before its
+** end (close). The same bucket can then have more rows, one per run.
+*/
+typedef struct
+{
+    CsvMaker csv_maker;
+    char label[16];
+    time_t bucket_seconds;
+    time_t bucket_offset;
+    time_t started;
+    time_t bucket_start;
+    size_t model_count;
+    ModelSummary models[AGGREGATOR_MODELS];
+}Aggregator;
+
+
+void
+running_stats_init(RunningStats * stats);
+
+
+void
+running_stats_add(
+    RunningStats * stats
+    , double value);
+
+
+double
+running_stats_variance(const RunningStats * stats);
+
+
+double
+running_stats_quantile(
+    const RunningStats * stats
+    , size_t index);
+
+
+/*
+** Initialization of aggregator started at given time
+*/
+void
+aggregator_init(
+    Aggregator * aggregator
+    , const CsvMaker * csv_maker
+    , const char * label
+    , time_t bucket_seconds
+    , time_t bucket_offset
+    , time_t now);
+
+
+/*
+** Start of time bucket which contains given time
+*/
+time_t
+aggregator_bucket(
+    const Aggregator * aggregator
+    , time_t t);
+
+
+/*
+** Adding of record received at given time. Summary of previous bucket is
+** flushed when the record belongs to a new bucket.
+*/
+bool
+aggregator_add(
+    Aggregator * aggregator
+    , const Glass * glass
+    , time_t t);
+
+
+/*
+** Flushing of summary when given time is past the current bucket
+*/
+bool
+aggregator_tick(
+    Aggregator * aggregator
+    , time_t t);
+
+
+/*
+** Unconditional writing of summary of current bucket at given time and its
+** reset, bucket which is not over yet is marked partial
+*/
+bool
+aggregator_flush(
+    Aggregator * aggregator
+    , time_t t);
+
+
+#endif
@@ -0,0 +1,490 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "tsstore.h"
+#include "spool.h"
+
+
+/*
+** Writer of bit stream into caller buffer
+*/
+typedef struct
+{
+    uint8_t * data;
+    size_t size;
+    size_t bits;
+    bool overflow;
+}BitWriter;
+
+
+/*
+** Reader of bit stream
+*/
+typedef struct
+{
+    const uint8_t * data;
+    size_t size;
+    size_t bits;
+    bool overflow;
+}BitReader;
+
+
+static void
+bits_write(
+    BitWriter * writer
+    , uint64_t value
+    , unsigned count)
+{
+    if(writer->bits + count > writer->size * 8)
+    {
+        writer->overflow = true;
+        return;
+    }
+
+    while(count > 0)
+    {
+        size_t byte = writer->bits / 8;
+        unsigned free = 8 - writer->bits % 8;
+        unsigned n = count < free ? count : free;
+        uint8_t chunk =
+            (uint8_t) ((value >> (count - n)) & ((1u << n) - 1));
+
+        if(writer->bits % 8 == 0)
+            writer->data[byte] = 0;
+
+        writer->data[byte] |= (uint8_t) (chunk << (free - n));
+        writer->bits += n;
+        count -= n;
+    }
+}
+
+
+static uint64_t
+bits_read(
+    BitReader * reader
+    , unsigned count)
+{
+    uint64_t value = 0;
+
+    if(reader->bits + count > reader->size * 8)
+    {
+        reader->overflow = true;
+        return 0;
+    }
+
+    while(count > 0)
+    {
+        size_t byte = reader->bits / 8;
+        unsigned left = 8 - reader->bits % 8;
+        unsigned n = count < left ? count : left;
+
+        value =
+            (value << n)
+            | ((reader->data[byte] >> (left - n)) & ((1u << n) - 1));
+        reader->bits += n;
+        count -= n;
+    }
+
+    return value;
+}
+
+
+static int64_t
+sign_extend(
+    uint64_t value
+    , unsigned bits)
+{
+    uint64_t sign = (uint64_t) 1 << (bits - 1);
+
+    return (int64_t) ((value ^ sign) - sign);
+}
+
+
+/*
+** Delta of delta of sample times is stored in the smallest of buckets
+** 0 / 7 / 9 / 12 / 32 bits. Buckets hold two's complement values, so 7
+** bits are -64..63. Caller checks that dod fits into 32 bits.
+*/
+static void
+encode_time(
+    BitWriter * writer
+    , int64_t dod)
+{
+    if(dod == 0)
+        bits_write(writer, 0, 1);
+    else if(dod >= -64 && dod <= 63)
+    {
+        bits_write(writer, 0x2, 2);
+        bits_write(writer, (uint64_t) dod & 0x7F, 7);
+    }
+    else if(dod >= -256 && dod <= 255)
+    {
+        bits_write(writer, 0x6, 3);
+        bits_write(writer, (uint64_t) dod & 0x1FF, 9);
+    }
+    else if(dod >= -2048 && dod <= 2047)
+    {
+        bits_write(writer, 0xE, 4);
+        bits_write(writer, (uint64_t) dod & 0xFFF, 12);
+    }
+    else
+    {
+        bits_write(writer, 0xF, 4);
+        bits_write(writer, (uint64_t) dod & 0xFFFFFFFF, 32);
+    }
+}
+
+
+static int64_t
+decode_time(BitReader * reader)
+{
+    if(bits_read(reader, 1) == 0)
+        return 0;
+
+    if(bits_read(reader, 1) == 0)
+        return sign_extend(bits_read(reader, 7), 7);
+
+    if(bits_read(reader, 1) == 0)
+        return sign_extend(bits_read(reader, 9), 9);
+
+    if(bits_read(reader, 1) == 0)
+        return sign_extend(bits_read(reader, 12), 12);
+
+    return sign_extend(bits_read(reader, 32), 32);
+}
+
+
+static uint32_t
+float_bits(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    return bits;
+}
+
+
+static float
+bits_float(uint32_t bits)
+{
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+
+    return value;
+}
+
+
+static unsigned
+leading_zeros(uint32_t x)
+{
+    return x == 0 ? 32 : (unsigned) __builtin_clz(x);
+}
+
+
+static unsigned
+trailing_zeros(uint32_t x)
+{
+    return x == 0 ? 32 : (unsigned) __builtin_ctz(x);
+}
+
+
+/*
+** XOR of value with previous one: '0' for same value, '10' when meaningful
+** bits fit into previous window, '11' with 5 bits of leading zeros and
+** 5 bits of length minus one for new window
+*/
+static void
+encode_values(
+    BitWriter * writer
+    , size_t channels
+    , size_t channel
+    , size_t count
+    , const float values[])
+{
+    uint32_t previous = float_bits(values[channel]);
+    unsigned leading = 33;
+    unsigned trailing = 0;
+
+    bits_write(writer, previous, 32);
+
+    for(size_t i = 1; i < count; i++)
+    {
+        uint32_t value = float_bits(values[i * channels + channel]);
+        uint32_t x = value ^ previous;
+
+        previous = value;
+
+        if(x == 0)
+        {
+            bits_write(writer, 0, 1);
+            continue;
+        }
+
+        unsigned lz = leading_zeros(x);
+        unsigned tz = trailing_zeros(x);
+
+        if(leading <= 32 && lz >= leading && tz >= trailing)
+        {
+            bits_write(writer, 0x2, 2);
+            bits_write(writer, x >> trailing, 32 - leading - trailing);
+        }
+        else
+        {
+            if(lz > 31)
+                lz = 31;
+
+            leading = lz;
+            trailing = tz;
+
+            unsigned length = 32 - leading - trailing;
+
+            bits_write(writer, 0x3, 2);
+            bits_write(writer, leading, 5);
+            bits_write(writer, length - 1, 5);
+            bits_write(writer, x >> trailing, length);
+        }
+    }
+}
+
+
+static void
+decode_values(
+    BitReader * reader
+    , size_t channels
+    , size_t channel
+    , size_t count
+    , float values[])
+{
+    uint32_t previous = (uint32_t) bits_read(reader, 32);
+    unsigned leading = 0;
+    unsigned trailing = 0;
+
+    values[channel] = bits_float(previous);
+
+    for(size_t i = 1; i < count && reader->overflow == false; i++)
+    {
+        if(bits_read(reader, 1) == 1)
+        {
+            if(bits_read(reader, 1) == 1)
+            {
+                leading = (unsigned) bits_read(reader, 5);
+                unsigned length = (unsigned) bits_read(reader, 5) + 1;
+
+                if(leading + length > 32)
+                {
+                    reader->overflow = true;
+                    return;
+                }
+
+                trailing = 32 - leading - length;
+            }
+
+            uint32_t x =
+                (uint32_t) bits_read(reader, 32 - leading - trailing);
+
+            previous ^= x << trailing;
+        }
+
+        values[i * channels + channel] = bits_float(previous);
+    }
+}
+
+
+size_t
+ts_encoded_bound(
+    size_t channels
+    , size_t count)
+{
+    return TS_BLOCK_HEADER_SIZE
+        + (count * 36 + channels * (32 + count * 44)) / 8
+        + 8;
+}
+
+
+size_t
+ts_encode(
+    uint32_t id
+    , size_t channels
+    , size_t count
+    , const int64_t time_us[]
+    , const float values[]
+    , uint8_t * buffer
+    , size_t size)
+{
+    if(channels == 0
+        || channels > TS_MAX_CHANNELS
+        || count == 0
+        || count > UINT32_MAX
+        || size < TS_BLOCK_HEADER_SIZE)
+        return 0;
+
+    BitWriter writer =
+        {.data = buffer + TS_BLOCK_HEADER_SIZE
+        , .size = size - TS_BLOCK_HEADER_SIZE};
+    int64_t delta = 0;
+
+    for(size_t i = 1; i < count; i++)
+    {
+        int64_t current = time_us[i] - time_us[i - 1];
+        int64_t dod = current - delta;
+
+        // 32 bits escape is the largest bucket
+        if(dod < INT32_MIN || dod > INT32_MAX)
+            return 0;
+
+        encode_time(&writer, dod);
+        delta = current;
+    }
+
+    for(size_t c = 0; c < channels; c++)
+        encode_values(&writer, channels, c, count, values);
+
+    if(writer.overflow == true)
+        return 0;
+
+    size_t payload = (writer.bits + 7) / 8;
+    uint32_t magic = TS_MAGIC;
+    uint16_t version = TS_VERSION;
+    uint16_t channel_count = (uint16_t) channels;
+    uint32_t sample_count = (uint32_t) count;
+    uint32_t payload_length = (uint32_t) payload;
+    uint32_t crc = crc32_update(0, writer.data, payload);
+
+    memcpy(buffer, &magic, 4);
+    memcpy(buffer + 4, &version, 2);
+    memcpy(buffer + 6, &channel_count, 2);
+    memcpy(buffer + 8, &id, 4);
+    memcpy(buffer + 12, &sample_count, 4);
+    memcpy(buffer + 16, &time_us[0], 8);
+    memcpy(buffer + 24, &payload_length, 4);
+    memcpy(buffer + 28, &crc, 4);
+
+    return TS_BLOCK_HEADER_SIZE + payload;
+}
+
+
+bool
+ts_decode(
+    const uint8_t * buffer
+    , size_t size
+    , TsBlockInfo * info
+    , int64_t time_us[]
+    , float values[]
+    , size_t capacity)
+{
+    uint32_t magic;
+    uint16_t version;
+    uint32_t crc;
+
+    if(size < TS_BLOCK_HEADER_SIZE)
+        return false;
+
+    memcpy(&magic, buffer, 4);
+    memcpy(&version, buffer + 4, 2);
+    memcpy(&info->channels, buffer + 6, 2);
+    memcpy(&info->id, buffer + 8, 4);
+    memcpy(&info->count, buffer + 12, 4);
+    memcpy(&info->start_us, buffer + 16, 8);
+    memcpy(&info->payload, buffer + 24, 4);
+    memcpy(&crc, buffer + 28, 4);
+
+    if(magic != TS_MAGIC
+        || version != TS_VERSION
+        || info->channels == 0
+        || info->channels > TS_MAX_CHANNELS
+        || info->count == 0
+        || info->count > capacity
+        || info->payload > size - TS_BLOCK_HEADER_SIZE
+        || crc32_update(0, buffer + TS_BLOCK_HEADER_SIZE, info->payload) != crc)
+        return false;
+
+    BitReader reader =
+        {.data = buffer + TS_BLOCK_HEADER_SIZE
+        , .size = info->payload};
+    int64_t delta = 0;
+
+    time_us[0] = info->start_us;
+
+    for(size_t i = 1; i < info->count; i++)
+    {
+        delta += decode_time(&reader);
+        time_us[i] = time_us[i - 1] + delta;
+    }
+
+    for(size_t c = 0; c < info->channels; c++)
+        decode_values(&reader, info->channels, c, info->count, values);
+
+    return reader.overflow == false;
+}
+
+
+bool
+ts_file_name(
+    const CsvMaker * csv_maker
+    , time_t t
+    , char * buffer
+    , size_t size)
+{
+    struct tm tm;
+    localtime_r(&t, &tm);
+
+    int length =
+        snprintf(
+            buffer
+            , size
+            , "%s/%s-Kurven-%d-%02d-%02d.tsd"
+            , csv_maker->path
+            , csv_maker->name
+            , tm.tm_year + 1900
+            , tm.tm_mon + 1
+            , tm.tm_mday);
+
+    return length > 0 && (size_t) length < size;
+}
+
+
+bool
+ts_store_append(
+    const CsvMaker * csv_maker
+    , time_t t
+    , const uint8_t * block
+    , size_t length)
+{
+    char path[CSV_PATH_SIZE];
+
+    if(ts_file_name(csv_maker, t, path, sizeof(path)) == false)
+        return false;
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+
+    if(fd < 0)
+        return false;
+
+    bool result = true;
+
+    while(length > 0)
+    {
+        ssize_t n = write(fd, block, length);
+
+        if(n < 0)
+        {
+            if(errno == EINTR)
+                continue;
+
+            result = false;
+            break;
+        }
+
+        block += n;
+        length -= (size_t) n;
+    }
+
+    result = fdatasync(fd) == 0 && result;
+
+    return close(fd) == 0 && result;
+}
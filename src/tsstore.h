@@ -0,0 +1,114 @@
+#ifndef _TSSTORE_H_
+#define _TSSTORE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "csv.h"
+
+
+/*
+** Compressed store of process curves.
+**
+** Curves of one glass are one block, blocks are appended into daily file
+** <path>/<name>-Kurven-YYYY-MM-DD.tsd. Block is TS_BLOCK_HEADER_SIZE bytes
+** of header (host byte order):
+**
+**   offset 0   magic TS_MAGIC
+**   offset 4   version, uint16
+**   offset 6   number of channels, uint16
+**   offset 8   glass id, uint32
+**   offset 12  number of samples, uint32
+**   offset 16  time of the first sample in microseconds, int64
+**   offset 24  length of payload in bytes, uint32
+**   offset 28  CRC-32 of payload, uint32
+**
+** followed by bit stream of payload, most significant bit first. Times of
+** samples are encoded once for all channels as delta of delta in
+** microseconds, then values of every channel follow as XOR of float with
+** previous value (Gorilla encoding).
+*/
+#define TS_MAGIC 0x31445354u
+#define TS_VERSION 1
+#define TS_MAX_CHANNELS 8
+#define TS_BLOCK_HEADER_SIZE 32
+
+
+/*
+** Header of one block
+*/
+typedef struct
+{
+    uint32_t id;
+    uint16_t channels;
+    uint32_t count;
+    int64_t start_us;
+    uint32_t payload;
+}TsBlockInfo;
+
+
+/*
+** Size of buffer which is always enough for encoded block
+*/
+size_t
+ts_encoded_bound(
+    size_t channels
+    , size_t count);
+
+
+/*
+** Encoding of count samples of channels into block. Values are stored by
+** samples, values[i * channels + c] is channel c of sample i. Returns
+** length of block or 0 when buffer is too small or change of sampling
+** interval does not fit into 32 bits.
+*/
+size_t
+ts_encode(
+    uint32_t id
+    , size_t channels
+    , size_t count
+    , const int64_t time_us[]
+    , const float values[]
+    , uint8_t * buffer
+    , size_t size);
+
+
+/*
+** Decoding of block into arrays owned by caller, they have place for
+** capacity samples. Returns false for damaged block or small arrays.
+*/
+bool
+ts_decode(
+    const uint8_t * buffer
+    , size_t size
+    , TsBlockInfo * info
+    , int64_t time_us[]
+    , float values[]
+    , size_t capacity);
+
+
+/*
+** Name of daily curve file for given time
+*/
+bool
+ts_file_name(
+    const CsvMaker * csv_maker
+    , time_t t
+    , char * buffer
+    , size_t size);
+
+
+/*
+** Appending of encoded block into daily curve file
+*/
+bool
+ts_store_append(
+    const CsvMaker * csv_maker
+    , time_t t
+    , const uint8_t * block
+    , size_t length);
+
+
+#endif
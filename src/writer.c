@@ -0,0 +1,616 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "writer.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#endif
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+#define WRITER_HAS_URING 1
+#else
+#define WRITER_HAS_URING 0
+#endif
+
+
+/*
+** Writing of whole data at given offset with plain pwrite()
+*/
+static bool
+posix_write(
+    int fd
+    , const char * data
+    , size_t length
+    , off_t offset)
+{
+    while(length > 0)
+    {
+        ssize_t n = pwrite(fd, data, length, offset);
+
+        if(n < 0)
+        {
+            if(errno == EINTR)
+                continue;
+
+            return false;
+        }
+
+        data += n;
+        length -= (size_t) n;
+        offset += n;
+    }
+
+    return true;
+}
+
+
+#if WRITER_HAS_URING
+
+/*
+** User data of fdatasync request, write requests carry index of their
+** registered buffer
+*/
+#define URING_SYNC_DATA WRITER_BUFFERS
+#define URING_ENTRIES (2 * WRITER_BUFFERS)
+#define URING_SQ_IDLE_MS 1000
+
+
+struct UringState
+{
+    int ring_fd;
+    bool sqpoll;
+    void * sq_ring;
+    size_t sq_ring_size;
+    void * cq_ring;
+    size_t cq_ring_size;
+    struct io_uring_sqe * sqes;
+    size_t sqes_size;
+    unsigned * sq_head;
+    unsigned * sq_tail;
+    unsigned * sq_flags;
+    unsigned * sq_array;
+    unsigned sq_mask;
+    unsigned * cq_head;
+    unsigned * cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe * cqes;
+    unsigned in_flight;
+    bool sync_busy;
+    uint64_t sync_append;
+    uint64_t failed_append;
+    bool busy[WRITER_BUFFERS];
+    unsigned lengths[WRITER_BUFFERS];
+    uint64_t appends[WRITER_BUFFERS];
+    _Alignas(4096) char buffers[WRITER_BUFFERS][WRITER_BUFFER_SIZE];
+};
+
+
+static void
+uring_destroy(UringState * uring)
+{
+    if(uring->sqes != NULL)
+        munmap(uring->sqes, uring->sqes_size);
+
+    if(uring->cq_ring != NULL && uring->cq_ring != uring->sq_ring)
+        munmap(uring->cq_ring, uring->cq_ring_size);
+
+    if(uring->sq_ring != NULL)
+        munmap(uring->sq_ring, uring->sq_ring_size);
+
+    if(uring->ring_fd >= 0)
+        close(uring->ring_fd);
+
+    free(uring);
+}
+
+
+static void *
+uring_map(
+    int fd
+    , size_t size
+    , off_t offset)
+{
+    void * memory =
+        mmap(
+            NULL
+            , size
+            , PROT_READ | PROT_WRITE
+            , MAP_SHARED | MAP_POPULATE
+            , fd
+            , offset);
+
+    return memory == MAP_FAILED ? NULL : memory;
+}
+
+
+/*
+** Creation of io_uring instance with registered buffers and output file.
+** Kernel side submission polling is used when it is permitted.
+*/
+static UringState *
+uring_create(int fd)
+{
+    UringState * uring = aligned_alloc(4096, sizeof(UringState));
+
+    if(uring == NULL)
+        return NULL;
+
+    memset(uring, 0, sizeof(UringState));
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_SQPOLL;
+    params.sq_thread_idle = URING_SQ_IDLE_MS;
+
+    uring->ring_fd = (int) syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+
+    if(uring->ring_fd < 0)
+    {
+        memset(&params, 0, sizeof(params));
+        uring->ring_fd =
+            (int) syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+    }
+
+    if(uring->ring_fd < 0)
+    {
+        free(uring);
+        return NULL;
+    }
+
+    uring->sqpoll = (params.flags & IORING_SETUP_SQPOLL) != 0;
+    uring->sq_ring_size =
+        params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    uring->cq_ring_size =
+        params.cq_off.cqes
+        + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    if(params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if(uring->cq_ring_size > uring->sq_ring_size)
+            uring->sq_ring_size = uring->cq_ring_size;
+
+        uring->cq_ring_size = uring->sq_ring_size;
+        uring->sq_ring =
+            uring_map(uring->ring_fd, uring->sq_ring_size, IORING_OFF_SQ_RING);
+        uring->cq_ring = uring->sq_ring;
+    }
+    else
+    {
+        uring->sq_ring =
+            uring_map(uring->ring_fd, uring->sq_ring_size, IORING_OFF_SQ_RING);
+        uring->cq_ring =
+            uring_map(uring->ring_fd, uring->cq_ring_size, IORING_OFF_CQ_RING);
+    }
+
+    uring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    uring->sqes = uring_map(uring->ring_fd, uring->sqes_size, IORING_OFF_SQES);
+
+    if(uring->sq_ring == NULL
+        || uring->cq_ring == NULL
+        || uring->sqes == NULL)
+    {
+        uring_destroy(uring);
+        return NULL;
+    }
+
+    char * sq = uring->sq_ring;
+    char * cq = uring->cq_ring;
+
+    uring->sq_head = (unsigned *) (sq + params.sq_off.head);
+    uring->sq_tail = (unsigned *) (sq + params.sq_off.tail);
+    uring->sq_flags = (unsigned *) (sq + params.sq_off.flags);
+    uring->sq_array = (unsigned *) (sq + params.sq_off.array);
+    uring->sq_mask = *(unsigned *) (sq + params.sq_off.ring_mask);
+    uring->cq_head = (unsigned *) (cq + params.cq_off.head);
+    uring->cq_tail = (unsigned *) (cq + params.cq_off.tail);
+    uring->cq_mask = *(unsigned *) (cq + params.cq_off.ring_mask);
+    uring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+
+    struct iovec iovecs[WRITER_BUFFERS];
+
+    for(size_t i = 0; i < WRITER_BUFFERS; i++)
+        iovecs[i] = (struct iovec)
+            {.iov_base = uring->buffers[i]
+            , .iov_len = WRITER_BUFFER_SIZE};
+
+    if(syscall(
+            __NR_io_uring_register
+            , uring->ring_fd
+            , IORING_REGISTER_BUFFERS
+            , iovecs
+            , WRITER_BUFFERS) != 0
+        || syscall(
+            __NR_io_uring_register
+            , uring->ring_fd
+            , IORING_REGISTER_FILES
+            , &fd
+            , 1) != 0)
+    {
+        uring_destroy(uring);
+        return NULL;
+    }
+
+    return uring;
+}
+
+
+/*
+** Preparation of next submission queue entry. Queue can not be full,
+** because number of requests in flight is limited by number of buffers.
+*/
+static struct io_uring_sqe *
+uring_sqe(UringState * uring)
+{
+    unsigned tail = *uring->sq_tail;
+    unsigned index = tail & uring->sq_mask;
+    struct io_uring_sqe * sqe = &uring->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    uring->sq_array[index] = index;
+
+    return sqe;
+}
+
+
+static void
+uring_commit(UringState * uring)
+{
+    __atomic_store_n(uring->sq_tail, *uring->sq_tail + 1, __ATOMIC_RELEASE);
+    uring->in_flight++;
+}
+
+
+/*
+** Submission of prepared entries and optional waiting for completions.
+** With submission polling no system call is needed unless kernel thread
+** went to sleep.
+*/
+static bool
+uring_enter(
+    UringState * uring
+    , unsigned to_submit
+    , unsigned min_complete)
+{
+    unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+
+    if(uring->sqpoll == true)
+    {
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        if(__atomic_load_n(uring->sq_flags, __ATOMIC_RELAXED)
+            & IORING_SQ_NEED_WAKEUP)
+            flags |= IORING_ENTER_SQ_WAKEUP;
+        else if(min_complete == 0)
+            return true;
+    }
+
+    while(syscall(
+            __NR_io_uring_enter
+            , uring->ring_fd
+            , to_submit
+            , min_complete
+            , flags
+            , NULL
+            , 0) < 0)
+    {
+        if(errno != EINTR && errno != EAGAIN && errno != EBUSY)
+            return false;
+    }
+
+    return true;
+}
+
+
+/*
+** Remembering of the first failed append
+*/
+static void
+uring_fail(
+    UringState * uring
+    , uint64_t append)
+{
+    if(uring->failed_append == 0 || append < uring->failed_append)
+        uring->failed_append = append;
+}
+
+
+/*
+** Processing of all available completions
+*/
+static void
+uring_reap(UringState * uring)
+{
+    unsigned head = *uring->cq_head;
+    unsigned tail = __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE);
+
+    for(; head != tail; head++)
+    {
+        struct io_uring_cqe * cqe = &uring->cqes[head & uring->cq_mask];
+
+        if(cqe->user_data == URING_SYNC_DATA)
+        {
+            uring->sync_busy = false;
+
+            if(cqe->res < 0)
+                uring_fail(uring, uring->sync_append);
+        }
+        else
+        {
+            size_t index = (size_t) cqe->user_data;
+            uring->busy[index] = false;
+
+            if(cqe->res < 0 || (unsigned) cqe->res != uring->lengths[index])
+                uring_fail(uring, uring->appends[index]);
+        }
+
+        uring->in_flight--;
+    }
+
+    __atomic_store_n(uring->cq_head, head, __ATOMIC_RELEASE);
+}
+
+
+/*
+** Finding of free registered buffer, waits for completion only when all
+** buffers are in flight
+*/
+static int
+uring_buffer(UringState * uring)
+{
+    while(true)
+    {
+        uring_reap(uring);
+
+        for(int i = 0; i < WRITER_BUFFERS; i++)
+        {
+            if(uring->busy[i] == false)
+                return i;
+        }
+
+        if(uring_enter(uring, 0, 1) == false)
+            return -1;
+    }
+}
+
+
+static bool
+uring_append(
+    Writer * writer
+    , const char * data
+    , size_t length)
+{
+    UringState * uring = writer->uring;
+    unsigned submitted = 0;
+
+    while(length > 0)
+    {
+        int index = uring_buffer(uring);
+
+        if(index < 0)
+            return false;
+
+        size_t chunk = length < WRITER_BUFFER_SIZE ? length : WRITER_BUFFER_SIZE;
+        memcpy(uring->buffers[index], data, chunk);
+
+        struct io_uring_sqe * sqe = uring_sqe(uring);
+        sqe->opcode = IORING_OP_WRITE_FIXED;
+        sqe->flags = IOSQE_FIXED_FILE;
+        sqe->fd = 0;
+        sqe->addr = (uint64_t) (uintptr_t) uring->buffers[index];
+        sqe->len = (unsigned) chunk;
+        sqe->off = (uint64_t) writer->offset;
+        sqe->buf_index = (uint16_t) index;
+        sqe->user_data = (uint64_t) index;
+
+        uring->busy[index] = true;
+        uring->lengths[index] = (unsigned) chunk;
+        uring->appends[index] = writer->appends;
+        uring_commit(uring);
+        submitted++;
+
+        data += chunk;
+        length -= chunk;
+        writer->offset += (off_t) chunk;
+    }
+
+    if(writer->sync_interval > 0
+        && ++writer->since_sync >= writer->sync_interval
+        && uring->sync_busy == false)
+    {
+        struct io_uring_sqe * sqe = uring_sqe(uring);
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_DRAIN;
+        sqe->fd = 0;
+        sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+        sqe->user_data = URING_SYNC_DATA;
+
+        uring->sync_busy = true;
+        uring->sync_append = writer->appends;
+        writer->since_sync = 0;
+        uring_commit(uring);
+        submitted++;
+    }
+
+    return uring_enter(uring, submitted, 0);
+}
+
+
+static bool
+uring_flush(UringState * uring)
+{
+    uring_reap(uring);
+
+    while(uring->in_flight > 0)
+    {
+        if(uring_enter(uring, 0, 1) == false)
+            return false;
+
+        uring_reap(uring);
+    }
+
+    return uring->failed_append == 0;
+}
+
+#endif
+
+
+bool
+writer_open(
+    Writer * writer
+    , const char * path
+    , WriterBackend preferred
+    , unsigned sync_interval)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+
+    if(fd < 0)
+        return false;
+
+    struct stat st;
+
+    if(fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    *writer = (Writer)
+        {.fd = fd
+        , .offset = st.st_size
+        , .backend = WriterPosix
+        , .sync_interval = sync_interval};
+
+#if WRITER_HAS_URING
+    if(preferred == WriterUring)
+    {
+        writer->uring = uring_create(fd);
+
+        if(writer->uring != NULL)
+            writer->backend = WriterUring;
+    }
+#else
+    (void) preferred;
+#endif
+
+    return true;
+}
+
+
+/*
+** Marking of writer as failed by given append, the first failed append is
+** kept
+*/
+static void
+writer_fail(
+    Writer * writer
+    , uint64_t append)
+{
+    if(writer->failed == false || append < writer->failed_append)
+        writer->failed_append = append;
+
+    writer->failed = true;
+}
+
+
+bool
+writer_append(
+    Writer * writer
+    , const void * data
+    , size_t length)
+{
+    writer->appends++;
+
+#if WRITER_HAS_URING
+    if(writer->backend == WriterUring)
+    {
+        if(uring_append(writer, data, length) == false)
+            writer_fail(writer, writer->appends);
+
+        uring_reap(writer->uring);
+
+        if(writer->uring->failed_append != 0)
+            writer_fail(writer, writer->uring->failed_append);
+
+        return writer->failed == false;
+    }
+#endif
+
+    if(posix_write(writer->fd, data, length, writer->offset) == false)
+    {
+        writer_fail(writer, writer->appends);
+        return false;
+    }
+
+    writer->offset += (off_t) length;
+
+    if(writer->sync_interval > 0
+        && ++writer->since_sync >= writer->sync_interval)
+    {
+        writer->since_sync = 0;
+
+        if(fdatasync(writer->fd) != 0)
+            writer_fail(writer, writer->appends);
+    }
+
+    return writer->failed == false;
+}
+
+
+bool
+writer_flush(Writer * writer)
+{
+#if WRITER_HAS_URING
+    if(writer->backend == WriterUring
+        && uring_flush(writer->uring) == false)
+        writer_fail(writer, writer->uring->failed_append);
+#endif
+
+    return writer->failed == false;
+}
+
+
+bool
+writer_close(Writer * writer)
+{
+    bool result = writer_flush(writer);
+
+#if WRITER_HAS_URING
+    if(writer->uring != NULL)
+        uring_destroy(writer->uring);
+#endif
+
+    if(writer->sync_interval > 0 && fdatasync(writer->fd) != 0)
+        result = false;
+
+    if(close(writer->fd) != 0)
+        result = false;
+
+    writer->fd = -1;
+    writer->uring = NULL;
+
+    return result;
+}
+
+
+const char *
+writer_backend_name(WriterBackend backend)
+{
+    switch(backend)
+    {
+        case WriterUring:
+            return "io_uring";
+        default:
+            return "write";
+    }
+}
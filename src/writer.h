@@ -0,0 +1,95 @@
+#ifndef _WRITER_H_
+#define _WRITER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+
+/*
+** Number and size of registered buffers of io_uring backend. Appends which
+** are longer than one buffer are split into several writes.
+*/
+#define WRITER_BUFFERS 8
+#define WRITER_BUFFER_SIZE 4096
+
+
+/*
+** Enum with output backends
+*/
+typedef enum
+{
+    WriterPosix
+    , WriterUring
+}WriterBackend;
+
+
+typedef struct UringState UringState;
+
+
+/*
+** Appending writer of one output file. With io_uring backend, appends and
+** periodic fdatasync are only submitted and completions are reaped in
+** batches by later calls, so caller never waits for the disk unless all
+** registered buffers are in flight. Errors of asynchronous writes are
+** reported by the next call, so failed_append tells which append failed.
+** Appends are numbered from 1, failed fdatasync is attributed to the
+** append which requested it. Writer stays failed until it is closed.
+*/
+typedef struct
+{
+    int fd;
+    off_t offset;
+    WriterBackend backend;
+    unsigned sync_interval;
+    unsigned since_sync;
+    uint64_t appends;
+    uint64_t failed_append;
+    bool failed;
+    UringState * uring;
+}Writer;
+
+
+/*
+** Opening of file for appending. When preferred backend is io_uring and
+** it is not available, writer falls back to plain write(). Sync interval
+** is number of appends between fdatasync calls, 0 disables them.
+*/
+bool
+writer_open(
+    Writer * writer
+    , const char * path
+    , WriterBackend preferred
+    , unsigned sync_interval);
+
+
+/*
+** Appending of data at the end of file
+*/
+bool
+writer_append(
+    Writer * writer
+    , const void * data
+    , size_t length);
+
+
+/*
+** Waiting for all submitted writes and reporting of their result
+*/
+bool
+writer_flush(Writer * writer);
+
+
+/*
+** Flushing, synchronization and closing of file
+*/
+bool
+writer_close(Writer * writer);
+
+
+const char *
+writer_backend_name(WriterBackend backend);
+
+
+#endif
@@ -1,10 +1,1001 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include "csvmaker.h"
+
+
+#define check(condition)                                            \
+    do                                                              \
+    {                                                               \
+        if(!(condition))                                            \
+        {                                                           \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            failures++;                                             \
+        }                                                           \
+    }while(0)
+
+
+static int failures = 0;
+
+
+/*
+** Big-endian stores into and loads from datablock fixtures, written byte by
+** byte independently of glass_view.h
+*/
+static void
+put_uint(
+    char * db
+    , size_t offset
+    , size_t size
+    , uint32_t value)
+{
+    for(size_t i = 0; i < size; i++)
+        db[offset + i] = (char) (value >> (8 * (size - 1 - i)));
+}
+
+
+static void
+put_float(
+    char * db
+    , size_t offset
+    , float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put_uint(db, offset, 4, bits);
+}
+
+
+static uint32_t
+get_uint(
+    const char * db
+    , size_t offset
+    , size_t size)
+{
+    uint32_t value = 0;
+
+    for(size_t i = 0; i < size; i++)
+        value = (value << 8) | (uint8_t) db[offset + i];
+
+    return value;
+}
+
+
+/*
+** Floats are compared bitwise, random records contain NaNs
+*/
+static bool
+same_float(
+    float value
+    , const char * db
+    , size_t offset)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    return bits == get_uint(db, offset, 4);
+}
+
+
+static bool
+same_dtl(
+    DTL dtl
+    , const char * db
+    , size_t offset)
+{
+    return dtl.YEAR == get_uint(db, offset, 2)
+        && dtl.MONTH == get_uint(db, offset + 2, 1)
+        && dtl.DAY == get_uint(db, offset + 3, 1)
+        && dtl.WEEKDAY == get_uint(db, offset + 4, 1)
+        && dtl.HOUR == get_uint(db, offset + 5, 1)
+        && dtl.MINUTE == get_uint(db, offset + 6, 1)
+        && dtl.SECOND == get_uint(db, offset + 7, 1)
+        && dtl.NANOSECOND == get_uint(db, offset + 8, 4);
+}
+
+
+static bool
+same_barrel(
+    BarrelInfo barrel
+    , const char * db
+    , size_t offset)
+{
+    return memcmp(barrel.batchNumber, db + offset + 2, 16) == 0
+        && barrel.batchNumber[16] == '\0'
+        && memcmp(barrel.serialNumber, db + offset + 20, 16) == 0
+        && barrel.serialNumber[16] == '\0'
+        && barrel.expiration_year == get_uint(db, offset + 36, 2)
+        && barrel.expiration_month == get_uint(db, offset + 38, 1)
+        && barrel.expiration == (get_uint(db, offset + 39, 1) & 1);
+}
+
+
+/*
+** Number of files in directory with given suffix
+*/
+static int
+count_files(
+    const char * path
+    , const char * suffix)
+{
+    DIR * directory = opendir(path);
+    struct dirent * entry;
+    int count = 0;
+
+    while(directory != NULL && (entry = readdir(directory)) != NULL)
+    {
+        size_t length = strlen(entry->d_name);
+
+        if(length >= strlen(suffix)
+            && strcmp(entry->d_name + length - strlen(suffix), suffix) == 0)
+            count++;
+    }
+
+    if(directory != NULL)
+        closedir(directory);
+
+    return count;
+}
+
+
+/*
+** Decoding of glass record and formating of csv line into caller owned
+** buffers
+*/
+static void
+test_csv_line(void)
+{
+    char db[DB_GLASS_STRUCT_SIZE] = {0};
+    db[GLASS_OFFSET_VEHICLE_MODEL] = T7;
+    put_uint(db, GLASS_OFFSET_ID, 4, 42);
+    memcpy(db + GLASS_OFFSET_JOB_NR, "JOB1234567", GLASS_JOB_NR_SIZE);
+
+    Glass glass;
+    check(read_glass_structure(DB_GLASS_STRUCT_SIZE, db, &glass) != NULL);
+    check(glass.id == 42);
+    check(strcmp(glass.jobNr, "JOB1234567") == 0);
+
+    GlassView view;
+    check(glass_view_init(&view, sizeof(db), db) == true);
+    check(glass_view_id(view) == 42 && glass_view_vehicle_model(view) == T7);
+    check(memcmp(glass_view_job_nr(view), "JOB1234567", GLASS_JOB_NR_SIZE)
+        == 0);
+    check(glass_view_init(&view, DB_GLASS_STRUCT_SIZE - 1, db) == false);
+
+    CsvMaker csv_maker;
+    csv_maker_init(&csv_maker, ".", "Test", ';');
+
+    char line[CSV_LINE_SIZE];
+    size_t length = format_csv_line(&csv_maker, &glass, line, sizeof(line));
+    check(length > 0);
+
+    size_t separators = 0;
+    for(size_t i = 0; i < length; i++)
+        separators += line[i] == ';';
+
+    check(separators == CSV_COLUMNS - 1);
+    check(format_csv_line(&csv_maker, &glass, line, 16) == 0);
+}
+
+
+/*
+** Decoding of pseudo-random records, fields of Glass structure and view
+** accessors are compared with byte by byte reference loads
+*/
+static void
+test_glass_view(void)
+{
+    char db[DB_GLASS_STRUCT_SIZE];
+    uint32_t seed = 2463534242u;
+    CsvMaker csv_maker;
+    char line[CSV_LINE_SIZE];
+    Glass glass;
+    GlassView view;
+
+    csv_maker_init(&csv_maker, ".", "Test", ';');
+
+    for(size_t record = 0; record < 64; record++)
+    {
+        for(size_t i = 0; i < sizeof(db); i++)
+        {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            db[i] = (char) seed;
+        }
+
+        check(read_glass_structure(sizeof(db), db, &glass) != NULL);
+        check(glass_view_init(&view, sizeof(db), db) == true);
+
+        check(memcmp(glass.jobNr, db + GLASS_OFFSET_JOB_NR, GLASS_JOB_NR_SIZE)
+            == 0 && glass.jobNr[GLASS_JOB_NR_SIZE] == '\0');
+        check(memcmp(
+                glass.vehicleNumber
+                , db + GLASS_OFFSET_VEHICLE_NUMBER
+                , GLASS_VEHICLE_NUMBER_SIZE) == 0
+            && glass.vehicleNumber[GLASS_VEHICLE_NUMBER_SIZE] == '\0');
+        check(memcmp(
+                glass.rearWindow
+                , db + GLASS_OFFSET_REAR_WINDOW
+                , GLASS_REAR_WINDOW_SIZE) == 0
+            && glass.rearWindow[GLASS_REAR_WINDOW_SIZE] == '\0');
+
+        check(glass.vehicleModel == get_uint(db, GLASS_OFFSET_VEHICLE_MODEL, 1));
+        check(glass_view_vehicle_model(view) == glass.vehicleModel);
+        check(glass.id == get_uint(db, GLASS_OFFSET_ID, 4));
+        check(glass_view_id(view) == glass.id);
+        check(glass.drawerIndex == get_uint(db, GLASS_OFFSET_DRAWER_INDEX, 2));
+        check(glass_view_drawer_index(view) == glass.drawerIndex);
+
+        check(glass.pistolTemperatureMin
+            == (int16_t) get_uint(db, GLASS_OFFSET_PISTOL_TEMP_MIN, 2));
+        check(glass.pistolTemperatureMax
+            == (int16_t) get_uint(db, GLASS_OFFSET_PISTOL_TEMP_MAX, 2));
+        check(glass.aPotTemperatureMin
+            == (int16_t) get_uint(db, GLASS_OFFSET_POT_TEMP_MIN, 2));
+        check(glass.aPotTemperatureMax
+            == (int16_t) get_uint(db, GLASS_OFFSET_POT_TEMP_MAX, 2));
+        check(glass.mixerTubeLife
+            == (int32_t) get_uint(db, GLASS_OFFSET_MIXER_TUBE_LIFE, 4));
+        check(glass_view_pistol_temperature_min(view)
+            == glass.pistolTemperatureMin);
+        check(glass_view_mixer_tube_life(view) == glass.mixerTubeLife);
+
+        check(same_float(glass.aApplicationRatio, db, GLASS_OFFSET_A_RATIO));
+        check(same_float(glass.bApplicationRatio, db, GLASS_OFFSET_B_RATIO));
+        check(same_float(glass.pistolTempDuringApp, db, GLASS_OFFSET_PISTOL_TEMP));
+        check(same_float(glass.aPotTempDuringApp, db, GLASS_OFFSET_POT_TEMP));
+        check(same_float(glass.aAppliedGlueAmount, db, GLASS_OFFSET_A_AMOUNT));
+        check(same_float(glass.bAppliedGlueAmount, db, GLASS_OFFSET_B_AMOUNT));
+        check(same_float(glass.ambientHumidity, db, GLASS_OFFSET_HUMIDITY));
+        check(same_float(
+            glass.ambientTemperature
+            , db
+            , GLASS_OFFSET_AMBIENT_TEMP));
+        check(same_float(
+            glass_view_pistol_temp_during_app(view)
+            , db
+            , GLASS_OFFSET_PISTOL_TEMP));
+
+        check(same_dtl(
+            glass.primerApplicationTime
+            , db
+            , GLASS_OFFSET_PRIMER_APPLICATION_TIME));
+        check(same_dtl(
+            glass.primerFlashoffTime
+            , db
+            , GLASS_OFFSET_PRIMER_FLASHOFF_TIME));
+        check(same_dtl(
+            glass.glueStartApplicationTime
+            , db
+            , GLASS_OFFSET_GLUE_START_TIME));
+        check(same_dtl(
+            glass.glueEndApplicationTime
+            , db
+            , GLASS_OFFSET_GLUE_END_TIME));
+        check(same_dtl(glass.assemblyTime, db, GLASS_OFFSET_ASSEMBLY_TIME));
+        check(same_dtl(
+            glass.timeSinceLastDispense
+            , db
+            , GLASS_OFFSET_LAST_DISPENSE_TIME));
+
+        for(size_t zone = 0; zone < 12; zone++)
+            check(glass.metralightZone[zone]
+                    == get_uint(db, GLASS_OFFSET_METRALIGHT + zone, 1)
+                && glass_view_metralight_zone(view, zone)
+                    == glass.metralightZone[zone]);
+
+        check(same_barrel(glass.A, db, GLASS_OFFSET_BARREL_A));
+        check(same_barrel(glass.B, db, GLASS_OFFSET_BARREL_B));
+
+        uint32_t zones = get_uint(db, GLASS_OFFSET_ZONES, 1);
+        uint32_t results = get_uint(db, GLASS_OFFSET_RESULTS, 1);
+        uint32_t enables = get_uint(db, GLASS_OFFSET_ENABLES, 1);
+
+        check(glass.zones.zone1 == (zones & 1)
+            && glass.zones.zone2 == ((zones >> 1) & 1)
+            && glass.zones.zone3 == ((zones >> 2) & 1)
+            && glass.zones.zone4 == ((zones >> 3) & 1));
+        check(glass.primerInspectionResult == ((results >> 1) & 1)
+            && glass.glueApplicationResult == ((results >> 2) & 1)
+            && glass.metralightEn == ((results >> 3) & 1)
+            && glass.dispenseCompleteSuccess == ((results >> 4) & 1)
+            && glass.robotCompleteSuccess == ((results >> 5) & 1)
+            && glass.rotaryUniteCompleteSucces == ((results >> 7) & 1));
+        check(glass.addhesiveProcessComplete == (enables & 1)
+            && glass.primerInspectionEnable == ((enables >> 2) & 1)
+            && glass.primerAppEnable == ((enables >> 3) & 1)
+            && glass.glueInspectionBypass == ((enables >> 4) & 1));
+
+        char expected[CSV_LINE_SIZE];
+        size_t length = format_csv_line(&csv_maker, &glass, line, sizeof(line));
+        int expected_length =
+            snprintf(
+                expected
+                , sizeof(expected)
+                , "%.*s;%.*s;%.*s;%s;%u;"
+                , GLASS_JOB_NR_SIZE
+                , db + GLASS_OFFSET_JOB_NR
+                , GLASS_VEHICLE_NUMBER_SIZE
+                , db + GLASS_OFFSET_VEHICLE_NUMBER
+                , GLASS_REAR_WINDOW_SIZE
+                , db + GLASS_OFFSET_REAR_WINDOW
+                , vehicle_model_to_string(
+                    get_uint(db, GLASS_OFFSET_VEHICLE_MODEL, 1))
+                , (unsigned) get_uint(db, GLASS_OFFSET_ID, 4));
+
+        check(length > 0
+            && strncmp(line, expected, (size_t) expected_length) == 0);
+    }
+}
+
+
+/*
+** Publishing into shared memory ring and reading with detection of lag
+*/
+static void
+test_ring(void)
+{
+    const char * name = "/csv_maker_autotest";
+    RingWriter writer;
+    RingReader reader;
+
+    check(ring_writer_open(&writer, name, 3) == true);
+    check(writer.header->slot_count == 4);
+    check(ring_reader_open(&reader, name) == true);
+
+    char db[DB_GLASS_STRUCT_SIZE] = {0};
+    Glass copy;
+    GlassView shared;
+
+    check(ring_reader_read(&reader, &copy, NULL) == RingEmpty);
+
+    put_uint(db, GLASS_OFFSET_ID, 4, 1);
+    ring_publish(&writer, db);
+    check(ring_reader_peek(&reader, &shared, NULL) == RingOK);
+    check(glass_view_id(shared) == 1);
+    check((const char *) shared.data - (const char *) reader.header
+        == RING_HEADER_SIZE + 8);
+    check(ring_reader_release(&reader) == RingOK);
+
+    for(uint32_t id = 2; id < 8; id++)
+    {
+        put_uint(db, GLASS_OFFSET_ID, 4, id);
+        ring_publish(&writer, db);
+    }
+
+    check(ring_reader_read(&reader, &copy, NULL) == RingLagged);
+    check(reader.lost == 2);
+    check(ring_reader_read(&reader, &copy, NULL) == RingOK);
+    check(copy.id == 4);
+
+    // reader follows ring which was removed and created again
+    ring_writer_close(&writer, name, true);
+    check(ring_reader_pending(&reader) == 3);
+
+    while(ring_reader_read(&reader, &copy, NULL) == RingOK)
+        continue;
+
+    check(copy.id == 7 && ring_reader_pending(&reader) == 0);
+    check(ring_writer_open(&writer, name, 8) == true);
+    put_uint(db, GLASS_OFFSET_ID, 4, 20);
+    ring_publish(&writer, db);
+    check(ring_reader_pending(&reader) == 1);
+    check(ring_reader_read(&reader, &copy, NULL) == RingReset);
+    check(ring_reader_read(&reader, &copy, NULL) == RingOK);
+    check(copy.id == 20);
+
+    // ring with other layout is re-created instead of resized
+    ring_writer_close(&writer, name, false);
+    check(ring_writer_open(&writer, name, 16) == true);
+    ring_publish(&writer, db);
+    check(ring_reader_read(&reader, &copy, NULL) == RingReset);
+    check(ring_reader_read(&reader, &copy, NULL) == RingOK);
+    check(reader.header->slot_count == 16);
+
+    ring_reader_close(&reader);
+    ring_writer_close(&writer, name, true);
+}
+
+
+/*
+** Running statistics and approximate quantiles
+*/
+static void
+test_running_stats(void)
+{
+    RunningStats stats;
+    running_stats_init(&stats);
+
+    for(int i = 1; i <= 1000; i++)
+        running_stats_add(&stats, i);
+
+    check(stats.count == 1000);
+    check(stats.min == 1 && stats.max == 1000);
+    check(stats.mean > 500.49 && stats.mean < 500.51);
+    check(running_stats_variance(&stats) > 83416 && running_stats_variance(&stats) < 83417);
+    check(running_stats_quantile(&stats, 0) > 490 && running_stats_quantile(&stats, 0) < 510);
+    check(running_stats_quantile(&stats, 1) > 940 && running_stats_quantile(&stats, 1) < 960);
+
+    // only NOK zones count as NOK, unused zones are not inspected
+    static Aggregator aggregator;
+    CsvMaker csv_maker;
+    Glass glass = {.vehicleModel = T7, .metralightEn = true};
+
+    csv_maker_init(&csv_maker, "build", "autotest", ';');
+    aggregator_init(&aggregator, &csv_maker, "Stunde", 3600, 0, -86400);
+    glass.metralightZone[0] = MetralightOK;
+    glass.metralightZone[1] = MetralightNOK;
+    glass.metralightZone[2] = MetralightError;
+    check(aggregator_add(&aggregator, &glass, 1000) == true);
+
+    const ModelSummary * summary = &aggregator.models[0];
+    check(summary->metralightInspected[0] == 1 && summary->metralightNok[0] == 0);
+    check(summary->metralightInspected[1] == 1 && summary->metralightNok[1] == 1);
+    check(summary->metralightNok[2] == 0 && summary->metralightError[2] == 1);
+    check(summary->metralightInspected[3] == 0 && summary->metralightNok[3] == 0);
+
+    // summary files are kept apart from production csv files, bucket
+    // flushed before its end is marked partial
+    check(system("rm -rf build/summary") == 0);
+    check(aggregator_flush(&aggregator, 1001) == true);
+    check(aggregator_add(&aggregator, &glass, 1002) == true);
+    check(aggregator_tick(&aggregator, 1002 + 3600) == true);
+    check(count_files("build/summary", ".csv") == 1);
+
+    CsvMaker summary_maker;
+    char path[CSV_PATH_SIZE];
+    char text[4096] = "";
+
+    csv_maker_init(&summary_maker, "build/summary", "autotest-Stunde", ';');
+    generate_csv_name(
+        &summary_maker
+        , aggregator_bucket(&aggregator, 1002)
+        , path
+        , sizeof(path));
+
+    FILE * file = fopen(path, "r");
+
+    if(file != NULL)
+    {
+        text[fread(text, 1, sizeof(text) - 1, file)] = '\0';
+        fclose(file);
+    }
+
+    char * row = strchr(text, '\n');
+    check(row != NULL && strstr(row, ";false;T7;1;") != NULL);
+    row = row != NULL ? strchr(row + 1, '\n') : NULL;
+    check(row != NULL && strstr(row, ";true;T7;1;") != NULL);
+    check(system("rm -rf build/summary") == 0);
+}
+
+
+/*
+** Appending through both output backends
+*/
+static void
+test_writer(void)
+{
+    const char * path = "build/autotest-writer.csv";
+    WriterBackend backends[] = {WriterPosix, WriterUring};
+    char data[WRITER_BUFFER_SIZE * 2 + 100];
+
+    for(size_t i = 0; i < sizeof(data); i++)
+        data[i] = 'a' + i % 26;
+
+    for(size_t i = 0; i < 2; i++)
+    {
+        Writer writer;
+        unlink(path);
+
+        check(writer_open(&writer, path, backends[i], 2) == true);
+
+        for(int j = 0; j < 20; j++)
+            check(writer_append(&writer, "line\n", 5) == true);
+
+        check(writer_append(&writer, data, sizeof(data)) == true);
+        check(writer_close(&writer) == true);
+
+        FILE * file = fopen(path, "r");
+        char read_back[sizeof(data)];
+        check(file != NULL);
+        check(fseek(file, 100, SEEK_SET) == 0);
+        check(fread(read_back, 1, sizeof(read_back), file) == sizeof(data));
+        check(memcmp(read_back, data, sizeof(data)) == 0);
+        check(ftell(file) == 100 + (long) sizeof(data));
+        fclose(file);
+
+        // failed write is attributed to its append also when it is
+        // reported by a later call
+        if(writer_open(&writer, "/dev/full", backends[i], 0) == true)
+        {
+            writer_append(&writer, "line\n", 5);
+            writer_append(&writer, "line\n", 5);
+            check(writer_flush(&writer) == false);
+            check(writer.failed_append == 1);
+            writer_close(&writer);
+        }
+    }
+
+    unlink(path);
+}
+
+
+/*
+** Recovery of torn and unterminated last lines
+*/
+static void
+test_recovery(void)
+{
+    const char * path = "build/autotest-recover.csv";
+    char db[DB_GLASS_STRUCT_SIZE] = {0};
+    char header[CSV_HEADER_SIZE];
+    char line[CSV_LINE_SIZE];
+    Glass glass;
+    CsvMaker csv_maker;
+    RecoveryInfo info;
+
+    csv_maker_init(&csv_maker, "build", "autotest", ';');
+    put_uint(db, GLASS_OFFSET_ID, 4, 7);
+    read_glass_structure(DB_GLASS_STRUCT_SIZE, db, &glass);
+
+    size_t header_length = format_csv_header(&csv_maker, header, sizeof(header));
+    size_t line_length = format_csv_line(&csv_maker, &glass, line, sizeof(line));
+
+    FILE * file = fopen(path, "w");
+    fwrite(header, 1, header_length, file);
+    fwrite(line, 1, line_length, file);
+    fwrite(line, 1, 20, file);
+    fclose(file);
+
+    check(recover_csv_tail(&csv_maker, path, &info) == true);
+    check(info.truncated == 20);
+    check(info.has_record == true && info.last_id == 7);
+    check(info.size == (off_t) (header_length + line_length));
+
+    // glass with the same id and other end of glue application is new glass
+    Glass other;
+    put_uint(db, GLASS_OFFSET_GLUE_END_TIME, 2, 2026);
+    read_glass_structure(DB_GLASS_STRUCT_SIZE, db, &other);
+    check(recovery_is_last(&info, &glass) == true);
+    check(recovery_is_last(&info, &other) == false);
+    recovery_set_last(&info, &other);
+    check(recovery_is_last(&info, &other) == true);
+    check(recovery_is_last(&info, &glass) == false);
+
+    // line written without terminator by older versions
+    file = fopen(path, "w");
+    fwrite(header, 1, header_length - 1, file);
+    fwrite("\n", 1, 1, file);
+    fwrite(line, 1, line_length - 1, file);
+    fclose(file);
+
+    check(recover_csv_tail(&csv_maker, path, &info) == true);
+    check(info.terminated == true && info.truncated == 0);
+    check(info.has_record == true && info.last_id == 7);
+
+    // torn header
+    file = fopen(path, "w");
+    fwrite(header, 1, 30, file);
+    fclose(file);
+
+    check(recover_csv_tail(&csv_maker, path, &info) == true);
+    check(info.size == 0 && info.has_record == false);
+
+    unlink(path);
+    check(recover_csv_tail(&csv_maker, path, &info) == true);
+}
+
+
+/*
+** Export of filtered and projected rows in order of file
+*/
+static void
+test_export(void)
+{
+    char db[DB_GLASS_STRUCT_SIZE] = {0};
+    char line[CSV_LINE_SIZE];
+    char path[CSV_PATH_SIZE];
+    Glass glass;
+    CsvMaker csv_maker;
+    ExportQuery query;
+    ExportStats stats;
+
+    csv_maker_init(&csv_maker, "build", "autotest", ';');
+    generate_csv_name(&csv_maker, time(NULL), path, sizeof(path));
+
+    FILE * file = fopen(path, "w");
+    fwrite(line, 1, format_csv_header(&csv_maker, line, sizeof(line)), file);
+
+    for(int i = 0; i < 1000; i++)
+    {
+        db[GLASS_OFFSET_VEHICLE_MODEL] = i % 2 ? T7 : ID_BUZZ;
+        put_uint(db, GLASS_OFFSET_ID, 4, (uint32_t) i);
+        read_glass_structure(DB_GLASS_STRUCT_SIZE, db, &glass);
+        fwrite(line, 1, format_csv_line(&csv_maker, &glass, line, sizeof(line)), file);
+    }
+
+    fclose(file);
+
+    export_query_init(&query, &csv_maker);
+    query.threads = 4;
+    check(export_add_filter(&query, "FahrzeugModell", "T7") == true);
+    check(export_add_filter(&query, "Unbekannt", "T7") == false);
+    check(export_set_columns(&query, "ScheibenNr,FahrzeugModell") == true);
+
+    char * output = NULL;
+    size_t size = 0;
+    FILE * memory = open_memstream(&output, &size);
+    check(export_run(&query, memory, &stats) == true);
+    fclose(memory);
+
+    check(stats.files == 1 && stats.rows == 1002 && stats.matched == 500);
+    check(strncmp(output, "ScheibenNr;FahrzeugModell\n1;T7\n3;T7\n", 34) == 0);
+    check(strcmp(output + size - 7, "999;T7\n") == 0);
+
+    free(output);
+    unlink(path);
+}
+
+
+/*
+** Sealing of spool segments by record count
+*/
+static void
+test_spool(void)
+{
+    Spool spool;
+    CsvMaker csv_maker;
+
+    csv_maker_init(&csv_maker, "build", "autotest", ';');
+    check(crc32_update(0, "123456789", 9) == 0xCBF43926);
+    check(system("rm -rf build/autotest-outbox") == 0);
+    check(spool_open(&spool, &csv_maker, "build/autotest-outbox", 2, 0) == true);
+
+    for(uint32_t id = 1; id <= 3; id++)
+        check(spool_append(&spool, "line\n", 5, id, 0) == true);
+
+    check(count_files("build/autotest-outbox", ".manifest") == 1);
+    check(count_files("build/autotest-outbox", ".csv") == 1);
+    check(spool.records == 1);
+    check(spool_close(&spool) == true);
+    check(count_files("build/autotest-outbox", ".manifest") == 2);
+    check(count_files("build/autotest-outbox/.work", "") == 2);
+    check(system("rm -rf build/autotest-outbox") == 0);
+
+    // segment left by crash is sealed with ids of its first and last line
+    char db[DB_GLASS_STRUCT_SIZE] = {0};
+    char text[4 * CSV_LINE_SIZE];
+    Glass glass;
+    size_t length = format_csv_header(&csv_maker, text, sizeof(text));
+
+    for(uint32_t id = 5; id <= 9; id += 4)
+    {
+        put_uint(db, GLASS_OFFSET_ID, 4, id);
+        read_glass_structure(sizeof(db), db, &glass);
+        length +=
+            format_csv_line(
+                &csv_maker
+                , &glass
+                , text + length
+                , sizeof(text) - length);
+    }
+
+    check(system("mkdir -p build/autotest-outbox/.work") == 0);
+    FILE * file = fopen("build/autotest-outbox/.work/autotest-left.csv", "w");
+    fwrite(text, 1, length, file);
+    fwrite("torn;", 1, 5, file);
+    fclose(file);
+
+    check(spool_open(&spool, &csv_maker, "build/autotest-outbox", 2, 0) == true);
+    file = fopen("build/autotest-outbox/autotest-left.csv.manifest", "r");
+    check(file != NULL);
+
+    if(file != NULL)
+    {
+        length = fread(text, 1, sizeof(text) - 1, file);
+        text[length] = '\0';
+        fclose(file);
+        check(strstr(text, "rows=2\n") != NULL);
+        check(strstr(text, "first_id=5\nlast_id=9\n") != NULL);
+    }
+
+    check(spool_close(&spool) == true);
+    check(system("rm -rf build/autotest-outbox") == 0);
+}
+
+
+/*
+** Hand over of records through real-time queue and latency histogram
+*/
+static void
+test_rt(void)
+{
+    static RtQueue queue;
+    RtRecord record;
+    char db[DB_GLASS_STRUCT_SIZE] = {0};
+
+    put_uint(db, GLASS_OFFSET_ID, 4, 7);
+
+    rt_queue_init(&queue);
+    check(rt_queue_pop(&queue, &record) == false);
+
+    for(size_t i = 0; i < RT_QUEUE_SLOTS; i++)
+        check(rt_queue_push(&queue, db, (time_t) i, i == 0) == true);
+
+    check(rt_queue_push(&queue, db, 0, false) == false);
+    check(rt_queue_pop(&queue, &record) == true);
+    check(get_uint(record.data, GLASS_OFFSET_ID, 4) == 7 && record.time == 0);
+    check(record.repeated == true);
+    check(rt_queue_push(&queue, db, 0, false) == true);
+
+    LatencyHistogram histogram;
+    latency_histogram_init(&histogram);
+
+    for(uint64_t i = 0; i < 99; i++)
+        latency_histogram_add(&histogram, 3000);
+
+    latency_histogram_add(&histogram, 5000000);
+    check(latency_histogram_percentile(&histogram, 0.5) == 4000);
+    check(latency_histogram_percentile(&histogram, 1.0) == 8192000);
+}
+
+
+/*
+** Round trip of process curves through compressed block
+*/
+static void
+test_tsstore(void)
+{
+    enum { channels = 2, count = 300 };
+    static int64_t time_us[count];
+    static float values[count * channels];
+    static int64_t decoded_time[count];
+    static float decoded[count * channels];
+    static uint8_t block[8192];
+
+    for(size_t i = 0; i < count; i++)
+    {
+        time_us[i] = 1700000000000000 + (int64_t) i * 10000 + (i % 7 == 0);
+        values[i * channels] = 4.5f + (float) (i / 20);
+        values[i * channels + 1] = 20.0f + (float) i * 0.25f;
+    }
+
+    check(ts_encoded_bound(channels, count) <= sizeof(block));
+
+    size_t length =
+        ts_encode(42, channels, count, time_us, values, block, sizeof(block));
+    check(length > 0 && length < count * channels * sizeof(float) / 2);
+
+    TsBlockInfo info;
+    check(ts_decode(block, length, &info, decoded_time, decoded, count) == true);
+    check(info.id == 42 && info.channels == channels && info.count == count);
+    check(memcmp(decoded_time, time_us, sizeof(time_us)) == 0);
+    check(memcmp(decoded, values, sizeof(values)) == 0);
+
+    block[length - 1] ^= 1;
+    check(ts_decode(block, length, &info, decoded_time, decoded, count) == false);
+
+    // delta of delta on both sides of every bucket boundary
+    static const int64_t dods[] =
+        {63, 64, -64, -65, 255, 256, -256, -257, 2047, 2048, -2048, -2049
+        , 100000, -100000, INT32_MAX, INT32_MIN};
+    enum { boundaries = sizeof(dods) / sizeof(dods[0]) + 2 };
+    int64_t delta = 10000;
+
+    time_us[0] = 1700000000000000;
+    time_us[1] = time_us[0] + delta;
+
+    for(size_t i = 2; i < boundaries; i++)
+    {
+        delta += dods[i - 2];
+        time_us[i] = time_us[i - 1] + delta;
+    }
+
+    length =
+        ts_encode(7, 1, boundaries, time_us, values, block, sizeof(block));
+    check(length > 0);
+    check(ts_decode(block, length, &info, decoded_time, decoded, count)
+        == true);
+    check(memcmp(decoded_time, time_us, boundaries * sizeof(time_us[0])) == 0);
+
+    time_us[2] = time_us[1] + 10000 + (int64_t) INT32_MAX + 1;
+    check(ts_encode(7, 1, 3, time_us, values, block, sizeof(block)) == 0);
+}
+
+
+/*
+** Compiling and evaluation of validation rules
+*/
+static void
+test_rules(void)
+{
+    RuleSet rules;
+    RuleVerdict verdict;
+    char error[128];
+
+    check(rules_compile(
+        &rules
+        , "# limits\n"
+          "fail pistol_cold if pistolTempDuringApp < pistolTemperatureMin\r\n"
+          "\n"
+          "reject barrel_a if aExpired == 1\n"
+          "warn nok if metralightNok > 0\n"
+        , error
+        , sizeof(error)) == true);
+    check(rules.count == 3);
+
+    char db[DB_GLASS_STRUCT_SIZE] = {0};
+    GlassView glass = {db};
+
+    put_uint(db, GLASS_OFFSET_PISTOL_TEMP_MIN, 2, 40);
+    put_float(db, GLASS_OFFSET_PISTOL_TEMP, 45.0f);
+    db[GLASS_OFFSET_METRALIGHT + 3] = (char) MetralightNOK;
+
+    check(rules_evaluate(&rules, glass, &verdict) == RuleWarn);
+    db[GLASS_OFFSET_BARREL_A + 39] = 1;
+    check(rules_evaluate(&rules, glass, &verdict) == RuleReject);
+    check(verdict.rule == 1 && verdict.triggered == 6);
+    put_float(db, GLASS_OFFSET_PISTOL_TEMP, 39.5f);
+    check(rules_evaluate(&rules, glass, &verdict) == RuleFail);
+    check(verdict.rule == 0);
+
+    // duration over the end of year by calendar arithmetic
+    check(dtl_to_civil_us((DTL) {.YEAR = 1970, .MONTH = 1, .DAY = 1}) == 0);
+    check(dtl_to_civil_us((DTL) {.YEAR = 2000, .MONTH = 3, .DAY = 1})
+        == 951868800LL * 1000000);
+    check(dtl_to_civil_us((DTL) {.YEAR = 2026, .MONTH = 13, .DAY = 1}) == -1);
+    check(rules_compile(
+        &rules
+        , "fail slow if glueDuration > 29\n"
+        , error
+        , sizeof(error)) == true);
+    memset(db, 0, sizeof(db));
+    check(rules_evaluate(&rules, glass, &verdict) == RulePass);
+    put_uint(db, GLASS_OFFSET_GLUE_START_TIME, 2, 2025);
+    put_uint(db, GLASS_OFFSET_GLUE_START_TIME + 2, 2, 12 << 8 | 31);
+    put_uint(db, GLASS_OFFSET_GLUE_START_TIME + 5, 3, 23 << 16 | 59 << 8 | 50);
+    put_uint(db, GLASS_OFFSET_GLUE_END_TIME, 2, 2026);
+    put_uint(db, GLASS_OFFSET_GLUE_END_TIME + 2, 2, 1 << 8 | 1);
+    put_uint(db, GLASS_OFFSET_GLUE_END_TIME + 7, 1, 20);
+    check(rules_evaluate(&rules, glass, &verdict) == RuleFail);
+    put_uint(db, GLASS_OFFSET_GLUE_END_TIME + 7, 1, 19);
+    check(rules_evaluate(&rules, glass, &verdict) == RulePass);
+
+    check(rules_compile(&rules, "fail x if unknown > 1\n", error, sizeof(error))
+        == false);
+    check(strcmp(error, "line 1: unknown field") == 0);
+
+    // file of exactly the maximal size is loaded, one byte more is not
+    const char * path = "build/autotest-rules.txt";
+    FILE * file = fopen(path, "w");
+    size_t size = fprintf(file, "warn nok if metralightNok > 0\n");
+
+    while(size < RULES_MAX * 256)
+        size += fputc(
+            size % 100 == 99 || size == RULES_MAX * 256 - 1 ? '\n' : '#'
+            , file) != EOF;
+
+    fclose(file);
+    check(rules_load(&rules, path, error, sizeof(error)) == true);
+    check(rules.count == 1);
+
+    file = fopen(path, "a");
+    fputc('\n', file);
+    fclose(file);
+    check(rules_load(&rules, path, error, sizeof(error)) == false);
+    check(strstr(error, "is too long") != NULL);
+    unlink(path);
+}
+
+
+/*
+** Parsing of configuration file with shared defaults and two cells
+*/
+static void
+test_config(void)
+{
+    static Config config;
+    CellConfig defaults =
+        {.address = "192.168.2.1"
+        , .slot = 1
+        , .db = 18
+        , .status_offset = 288
+        , .cpu = -1
+        , .path = "."
+        , .csv_name = "Klebezelle"
+        , .separator = ';'};
+    char error[128];
+
+    check(config_parse(
+        &config
+        , "# plant\n"
+          "writer = uring\n"
+          "[cell A]\n"
+          "poll_us = 500\n"
+          "[cell B]\n"
+          "  address = 192.168.3.1 \n"
+          "; second line\n"
+          "name = Zelle2\n"
+          "summary = yes\n"
+        , &defaults
+        , error
+        , sizeof(error)) == true);
+    check(config.cell_count == 2);
+
+    const CellConfig * a = config_find(&config, "A");
+    const CellConfig * b = config_find(&config, "B");
+
+    check(a != NULL && b != NULL && config_find(&config, "C") == NULL);
+    check(a->poll_us == 500 && a->backend == WriterUring);
+    check(strcmp(b->address, "192.168.3.1") == 0 && b->summary == true);
+    check(cell_config_same_connection(a, b) == false);
+    check(cell_config_same_csv(a, b) == false);
+
+    check(config_parse(
+        &config
+        , "[cell A]\n[cell B]\n"
+        , &defaults
+        , error
+        , sizeof(error)) == false);
+    check(strcmp(error, "cells A and B: same csv file") == 0);
+
+    check(config_parse(
+        &config
+        , "[cell A]\nstatus_offset = 10\n"
+        , &defaults
+        , error
+        , sizeof(error)) == false);
+    check(strcmp(error, "cell A: status_offset overlaps glass record") == 0);
+
+    check(config_parse(
+        &config
+        , "cpu = 2\n[cell A]\n[cell B]\nname = B\n"
+        , &defaults
+        , error
+        , sizeof(error)) == false);
+    check(strcmp(error, "cells A and B: same cpu") == 0);
+
+    // file of exactly the maximal size is loaded, one byte more is not
+    const char * path = "build/autotest-config.ini";
+    FILE * file = fopen(path, "w");
+    size_t size = fprintf(file, "[cell A]\n");
+
+    while(size < 65536)
+        size += fputc(size % 100 == 99 || size == 65535 ? '\n' : '#', file)
+            != EOF;
+
+    fclose(file);
+    check(config_load(&config, path, &defaults, error, sizeof(error)) == true);
+
+    file = fopen(path, "a");
+    fputc('\n', file);
+    fclose(file);
+    check(config_load(&config, path, &defaults, error, sizeof(error)) == false);
+    unlink(path);
+}
 
 
 int
 main(void)
 {
     printf("Auto-test\n");
-    return EXIT_SUCCESS;
-}   
+
+    test_csv_line();
+    test_glass_view();
+    test_ring();
+    test_running_stats();
+    test_writer();
+    test_recovery();
+    test_export();
+    test_spool();
+    test_rt();
+    test_tsstore();
+    test_rules();
+    test_config();
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}